@@ -21,9 +21,11 @@
 #include "config.h"
 #include "str_arg.h"
 #include "url_host.h"
+#include "url_instrumentation.h"
 #include "url_percent_encode.h"
 #include "url_result.h"
 #include "url_search_params.h"
+#include "url_tracing.h"
 #include "url_version.h"
 #include "util.h"
 #include <algorithm>
@@ -44,10 +46,19 @@ namespace upa {
 
 // forward declarations
 
+class url_builder;
+class base_url_resolver;
+class url_origin;
+class url_table;
+template <class T> class url_prefix_router;
+
 namespace detail {
     class url_serializer;
     class url_setter;
     class url_parser;
+    class url_builder_serializer;
+    struct url_parts;
+    struct url_record;
 
     // url_error what() values
     extern const char kURLParseError[];
@@ -189,6 +200,29 @@ class url {
         return parse(std::forward<T>(str_url), &base);
     }
 
+    /// @brief Parses given URL string against base URL, and reports validation errors.
+    ///
+    /// Non-failure validation errors (@a validation_errc::invalid_url_unit,
+    /// @a validation_errc::special_scheme_missing_following_solidus,
+    /// @a validation_errc::invalid_reverse_solidus, @a validation_errc::invalid_credentials,
+    /// @a validation_errc::ipv4_empty_part, @a validation_errc::ipv4_non_decimal_part,
+    /// @a validation_errc::ipv4_out_of_range_part (if the address is valid),
+    /// @a validation_errc::file_invalid_windows_drive_letter and
+    /// @a validation_errc::file_invalid_windows_drive_letter_host) are reported
+    /// by calling `sink(validation_errc err, std::size_t offset)`, where `offset`
+    /// is the position of the error in the @a str_url. The IPv4 errors of
+    /// internationalized domain names are reported at the host start.
+    ///
+    /// @param[in] str_url URL string to parse
+    /// @param[in] base    pointer to base URL, may be nullptr
+    /// @param[in] sink    validation error sink
+    /// @return error code (@a validation_errc::ok on success)
+    template <class T, class Sink, enable_if_str_arg_t<T> = 0>
+    validation_errc parse(T&& str_url, const url* base, Sink&& sink) {
+        const auto inp = make_str_arg(std::forward<T>(str_url));
+        return do_parse(inp.begin(), inp.end(), base, std::forward<Sink>(sink));
+    }
+
     /// @brief Parses given URL string against base URL.
     ///
     /// @param[in] str_url  URL string to parse
@@ -637,14 +671,16 @@ class url {
     explicit url(T&& str_url, const url* base, const char* what_arg);
 
     // parser
-    template <typename CharT>
-    validation_errc do_parse(const CharT* first, const CharT* last, const url* base);
+    template <typename CharT, class Sink = null_validation_sink>
+    validation_errc do_parse(const CharT* first, const CharT* last, const url* base, Sink&& sink = Sink{});
+    void set_parsed();
 
     template <class T, enable_if_str_arg_t<T> = 0>
     validation_errc for_can_parse(T&& str_url, const url* base);
 
     // get scheme info
-    static const scheme_info kSchemes[];
+    static const std::size_t kSchemeCount = 6;
+    static const scheme_info kSchemes[kSchemeCount];
     static const scheme_info* get_scheme_info(string_view src);
 
     // set scheme
@@ -677,12 +713,20 @@ class url {
     void clear_search_params() noexcept;
     void parse_search_params();
 
+    // hash of norm_url_
+    std::uint64_t hash_value() const noexcept;
+    void update_hash() noexcept;
+
 private:
     std::string norm_url_;
     std::array<std::size_t, PART_COUNT> part_end_ = {};
     const scheme_info* scheme_inf_ = nullptr;
     unsigned flags_ = INITIAL_FLAGS;
     std::size_t path_segment_count_ = 0;
+    // cached hash of norm_url_, computed after parsing and after each setter
+    // finishes its write; 0 means "not computed", then hash_value() hashes
+    // norm_url_ on each call
+    std::uint64_t hash_ = 0;
     detail::url_search_params_ptr search_params_ptr_;
 
     friend bool operator==(const url& lhs, const url& rhs) noexcept;
@@ -690,7 +734,15 @@ class url {
     friend class detail::url_serializer;
     friend class detail::url_setter;
     friend class detail::url_parser;
+    friend class detail::url_builder_serializer;
+    friend struct detail::url_parts;
+    friend struct detail::url_record;
     friend class url_search_params;
+    friend class url_builder;
+    friend class base_url_resolver;
+    friend class url_origin;
+    friend class url_table;
+    template <class T> friend class url_prefix_router;
 };
 
 
@@ -706,7 +758,10 @@ class url_serializer : public host_output {
         : host_output(need_save)
         , url_(dest_url)
         , last_pt_(url::SCHEME)
-    {}
+    {
+        // URL will be modified; the hash is computed again when it is done
+        url_.hash_ = 0;
+    }
 
     ~url_serializer() override = default;
 
@@ -760,6 +815,8 @@ class url_serializer : public host_output {
 
     using PathOpFn = bool (url::*)(std::size_t& path_end, std::size_t& segment_count) const;
     void append_parts(const url& src, url::PartType t1, url::PartType t2, PathOpFn pathOpFn = nullptr);
+    // copy src URL's parts from the beginning till the last_pt part, which ends at the end offset
+    void copy_prefix(const url& src, url::PartType last_pt, std::size_t end, std::size_t path_segment_count);
 
     // flags
     void set_flag(const url::UrlFlag flag) { url_.set_flag(flag); }
@@ -814,7 +871,8 @@ class url_setter : public url_serializer {
         , curr_pt_(url::SCHEME)
     {}
 
-    ~url_setter() override = default;
+    // the setter finished its write
+    ~url_setter() override { url_.update_hash(); }
 
     //???
     void reserve(std::size_t new_cap) override;
@@ -888,12 +946,18 @@ class url_parser {
         query_state,
         fragment_state
     };
+#ifdef UPA_URL_INSTRUMENTATION
+    static_assert(fragment_state + 1 == instrumentation::state_count,
+        "instrumentation::state_count must match the number of states");
+#endif
 
-    template <typename CharT>
-    static validation_errc url_parse(url_serializer& urls, const CharT* first, const CharT* last, const url* base, State state_override = not_set_state);
+    template <typename CharT, class Sink = null_validation_sink>
+    static validation_errc url_parse(url_serializer& urls, const CharT* first, const CharT* last, const url* base,
+        State state_override = not_set_state, State start_state = not_set_state, Sink&& sink = Sink{});
 
-    template <typename CharT>
-    static validation_errc parse_host(url_serializer& urls, const CharT* first, const CharT* last);
+    template <typename CharT, class Reporter = null_validation_reporter>
+    static validation_errc parse_host(url_serializer& urls, const CharT* first, const CharT* last,
+        const Reporter& warn = Reporter{});
 
     template <typename CharT>
     static void parse_path(url_serializer& urls, const CharT* first, const CharT* last);
@@ -953,6 +1017,7 @@ inline void do_remove_whitespace(const CharT*& first, const CharT*& last, simple
         if (!is_removable_char(*it))
             continue;
         // copy non whitespace chars into the new buffer and return it
+        UPA_INSTRUMENT_SLOW_PATH(remove_whitespace);
         buff.reserve(last - first);
         buff.append(first, it);
         for (; it < last; ++it) {
@@ -965,6 +1030,135 @@ inline void do_remove_whitespace(const CharT*& first, const CharT*& last, simple
     }
 }
 
+// Validation error reporting
+
+// Sink adapter which adds shift to the reported offsets
+template <class Sink>
+struct shifted_validation_sink {
+    Sink& sink;
+    std::size_t shift;
+
+    void operator()(validation_errc err, std::size_t offset) const {
+        sink(err, offset + shift);
+    }
+};
+
+// ASCII URL code points: ASCII alphanumeric, U+0021 (!), U+0024 ($) to U+002F (/),
+// U+003A (:), U+003B (;), U+003D (=), U+003F (?), U+0040 (@), U+005F (_), U+007E (~)
+// https://url.spec.whatwg.org/#url-code-points
+constexpr bool is_ascii_url_code_point(unsigned char c) noexcept {
+    return is_ascii_alpha(c) || is_ascii_digit(c) ||
+        c == '!' || (c >= '$' && c <= '/') ||
+        c == ':' || c == ';' || c == '=' || c == '?' || c == '@' || c == '_' || c == '~';
+}
+
+// Maps offsets in the input with ASCII tab or newline removed to offsets in
+// the original input. If the validation sink is disabled, then it is empty and
+// does nothing.
+template <bool Enabled>
+class removed_chars_map {
+public:
+    template <typename CharT>
+    void init(const CharT*, const CharT*) noexcept {}
+    bool empty() const noexcept { return true; }
+    std::size_t front() const noexcept { return 0; }
+    std::size_t operator()(std::size_t offset) const noexcept { return offset; }
+};
+
+template <>
+class removed_chars_map<true> {
+public:
+    // Remembers the original offsets of ASCII tab or newline in [first, last)
+    template <typename CharT>
+    void init(const CharT* first, const CharT* last) {
+        for (auto it = first; it != last; ++it) {
+            if (is_removable_char(*it))
+                removed_.push_back(static_cast<std::size_t>(it - first));
+        }
+    }
+    bool empty() const noexcept { return removed_.empty(); }
+    std::size_t front() const noexcept { return removed_.front(); }
+    std::size_t operator()(std::size_t offset) const noexcept {
+        // skip removed chars preceding or at the offset
+        for (const std::size_t pos : removed_) {
+            if (pos > offset)
+                break;
+            ++offset;
+        }
+        return offset;
+    }
+private:
+    std::vector<std::size_t> removed_;
+};
+
+// Reports validation errors to the sink with offsets in the original input.
+// The url_parser checks `enabled` before detecting non-failure errors.
+template <typename CharT, class Sink>
+class validation_reporter {
+public:
+    static const bool enabled = is_validation_sink_enabled<Sink>::value;
+
+    // Reports the first ASCII tab or newline in the [first, last), and
+    // remembers their offsets
+    validation_reporter(Sink& sink, const CharT* first, const CharT* last)
+        : sink_(sink)
+        , origin_(first)
+    {
+        if (enabled) {
+            removed_.init(first, last);
+            if (!removed_.empty())
+                sink_(validation_errc::invalid_url_unit, removed_.front());
+        }
+    }
+
+    // Sets the start of input with ASCII tab or newline removed
+    void set_origin(const CharT* origin) noexcept {
+        origin_ = origin;
+    }
+
+    void operator()(validation_errc err, const CharT* at) const {
+        sink_(err, removed_(static_cast<std::size_t>(at - origin_)));
+    }
+
+    // Reports invalid-URL-unit validation errors in [first, last). If
+    // special_path is true, then reports invalid-reverse-solidus for "\".
+    void check_url_units(const CharT* first, const CharT* last, bool special_path) const {
+        using UCharT = typename std::make_unsigned<CharT>::type;
+
+        for (auto it = first; it < last; ) {
+            const auto uch = static_cast<UCharT>(*it);
+            if (uch >= 0x80) {
+                const auto start = it;
+                const auto cp_res = url_utf::read_utf_char(it, last);
+                // not a URL code point: invalid sequence, surrogate or noncharacter
+                if (!cp_res.result ||
+                    (cp_res.value >= 0xFDD0 && cp_res.value <= 0xFDEF) ||
+                    (cp_res.value & 0xFFFE) == 0xFFFE)
+                    (*this)(validation_errc::invalid_url_unit, start);
+                continue;
+            }
+            if (uch == '%') {
+                // "%" must be followed by two ASCII hex digits
+                if (last - it < 3 || !is_hex_char(it[1]) || !is_hex_char(it[2]))
+                    (*this)(validation_errc::invalid_url_unit, it);
+            } else if (uch == '\\' && special_path) {
+                (*this)(validation_errc::invalid_reverse_solidus, it);
+            } else if (!is_ascii_url_code_point(static_cast<unsigned char>(uch))) {
+                (*this)(validation_errc::invalid_url_unit, it);
+            }
+            ++it;
+        }
+    }
+
+private:
+    Sink& sink_;
+    const CharT* origin_;
+    removed_chars_map<enabled> removed_;
+};
+
+template <typename CharT, class Sink>
+const bool validation_reporter<CharT, Sink>::enabled;
+
 // reverse find
 
 template<class InputIt, class T>
@@ -1066,6 +1260,7 @@ inline url::url(url&& other) noexcept
     , scheme_inf_(other.scheme_inf_)
     , flags_(other.flags_)
     , path_segment_count_(other.path_segment_count_)
+    , hash_(other.hash_)
     , search_params_ptr_(std::move(other.search_params_ptr_))
 {
     search_params_ptr_.set_url_ptr(this);
@@ -1105,6 +1300,7 @@ inline void url::move_record(url& other) UPA_NOEXCEPT_17 {
     scheme_inf_ = other.scheme_inf_;
     flags_ = other.flags_;
     path_segment_count_ = other.path_segment_count_;
+    hash_ = other.hash_;
 }
 
 // url getters
@@ -1243,6 +1439,14 @@ inline void url::parse_search_params() {
         search_params_ptr_.parse_params(get_part_view(QUERY));
 }
 
+inline std::uint64_t url::hash_value() const noexcept {
+    return hash_ ? hash_ : util::hash_bytes(norm_url_.data(), norm_url_.length());
+}
+
+inline void url::update_hash() noexcept {
+    hash_ = util::hash_bytes(norm_url_.data(), norm_url_.length());
+}
+
 inline string_view url::serialize(bool exclude_fragment) const {
     if (exclude_fragment && part_end_[FRAGMENT])
         return { norm_url_.data(), part_end_[QUERY] };
@@ -1362,6 +1566,7 @@ inline void url::clear() {
     scheme_inf_ = nullptr;
     flags_ = INITIAL_FLAGS;
     path_segment_count_ = 0;
+    hash_ = 0;
     clear_search_params();
 }
 
@@ -1377,8 +1582,9 @@ inline void url::swap(url& other) UPA_NOEXCEPT_17 {
 // without encoding, url and state override arguments. It resets this url object to
 // an empty value and then parses the input and modifies this url object.
 // Returns validation_errc::ok on success, or an error value on parsing failure.
-template <typename CharT>
-inline validation_errc url::do_parse(const CharT* first, const CharT* last, const url* base) {
+template <typename CharT, class Sink>
+inline validation_errc url::do_parse(const CharT* first, const CharT* last, const url* base, Sink&& sink) {
+    UPA_TRACE_SCOPE("url::parse");
     const validation_errc res = [&]() {
         detail::url_serializer urls(*this);
 
@@ -1390,18 +1596,34 @@ inline validation_errc url::do_parse(const CharT* first, const CharT* last, cons
             return validation_errc::invalid_base;
 
         // remove any leading and trailing C0 control or space:
+        const CharT* const input = first;
+        const CharT* const input_end = last;
         detail::do_trim(first, last);
-        //TODO-WARN: validation error if trimmed
 
+        if (is_validation_sink_enabled<Sink>::value) {
+            if (first != input)
+                sink(validation_errc::invalid_url_unit, 0);
+            if (last != input_end)
+                sink(validation_errc::invalid_url_unit, static_cast<std::size_t>(last - input));
+            // the parser reports offsets from the trimmed input start
+            return detail::url_parser::url_parse(urls, first, last, base,
+                detail::url_parser::not_set_state, detail::url_parser::not_set_state,
+                detail::shifted_validation_sink<typename std::remove_reference<Sink>::type>{
+                    sink, static_cast<std::size_t>(first - input) });
+        }
         return detail::url_parser::url_parse(urls, first, last, base);
     }();
-    if (res == validation_errc::ok) {
-        set_flag(VALID_FLAG);
-        parse_search_params();
-    }
+    if (res == validation_errc::ok)
+        set_parsed();
     return res;
 }
 
+inline void url::set_parsed() {
+    set_flag(VALID_FLAG);
+    update_hash();
+    parse_search_params();
+}
+
 template <class T, enable_if_str_arg_t<T>>
 validation_errc url::for_can_parse(T&& str_url, const url* base) {
     const auto inp = make_str_arg(std::forward<T>(str_url));
@@ -1432,6 +1654,7 @@ validation_errc url::for_can_parse(T&& str_url, const url* base) {
 
 template <class StrT, enable_if_str_arg_t<StrT>>
 inline bool url::href(StrT&& str) {
+    UPA_TRACE_SCOPE("url::href");
     url u; // parsedURL
 
     const auto inp = make_str_arg(std::forward<StrT>(str));
@@ -1444,6 +1667,7 @@ inline bool url::href(StrT&& str) {
 
 template <class StrT, enable_if_str_arg_t<StrT>>
 inline bool url::protocol(StrT&& str) {
+    UPA_TRACE_SCOPE("url::protocol");
     if (is_valid()) {
         detail::url_setter urls(*this);
 
@@ -1455,6 +1679,7 @@ inline bool url::protocol(StrT&& str) {
 
 template <class StrT, enable_if_str_arg_t<StrT>>
 inline bool url::username(StrT&& str) {
+    UPA_TRACE_SCOPE("url::username");
     if (canHaveUsernamePasswordPort()) {
         detail::url_setter urls(*this);
 
@@ -1471,6 +1696,7 @@ inline bool url::username(StrT&& str) {
 
 template <class StrT, enable_if_str_arg_t<StrT>>
 inline bool url::password(StrT&& str) {
+    UPA_TRACE_SCOPE("url::password");
     if (canHaveUsernamePasswordPort()) {
         detail::url_setter urls(*this);
 
@@ -1487,6 +1713,7 @@ inline bool url::password(StrT&& str) {
 
 template <class StrT, enable_if_str_arg_t<StrT>>
 inline bool url::host(StrT&& str) {
+    UPA_TRACE_SCOPE("url::host");
     if (!has_opaque_path() && is_valid()) {
         detail::url_setter urls(*this);
 
@@ -1498,6 +1725,7 @@ inline bool url::host(StrT&& str) {
 
 template <class StrT, enable_if_str_arg_t<StrT>>
 inline bool url::hostname(StrT&& str) {
+    UPA_TRACE_SCOPE("url::hostname");
     if (!has_opaque_path() && is_valid()) {
         detail::url_setter urls(*this);
 
@@ -1509,6 +1737,7 @@ inline bool url::hostname(StrT&& str) {
 
 template <class StrT, enable_if_str_arg_t<StrT>>
 inline bool url::port(StrT&& str) {
+    UPA_TRACE_SCOPE("url::port");
     if (canHaveUsernamePasswordPort()) {
         detail::url_setter urls(*this);
 
@@ -1527,6 +1756,7 @@ inline bool url::port(StrT&& str) {
 
 template <class StrT, enable_if_str_arg_t<StrT>>
 inline bool url::pathname(StrT&& str) {
+    UPA_TRACE_SCOPE("url::pathname");
     if (!has_opaque_path() && is_valid()) {
         detail::url_setter urls(*this);
 
@@ -1538,6 +1768,7 @@ inline bool url::pathname(StrT&& str) {
 
 template <class StrT, enable_if_str_arg_t<StrT>>
 inline bool url::search(StrT&& str) {
+    UPA_TRACE_SCOPE("url::search");
     bool res = false;
     if (is_valid()) {
         {
@@ -1565,6 +1796,7 @@ inline bool url::search(StrT&& str) {
 
 template <class StrT, enable_if_str_arg_t<StrT>>
 inline bool url::hash(StrT&& str) {
+    UPA_TRACE_SCOPE("url::hash");
     if (is_valid()) {
         detail::url_setter urls(*this);
 
@@ -1588,16 +1820,22 @@ namespace detail {
 
 // Implements "basic URL parser" https://url.spec.whatwg.org/#concept-basic-url-parser
 // without 1 step. It modifies the URL stored in the urls object.
+// If start_state is given (and state_override is not), then parsing starts
+// from this state as if the preceding states had been run.
+// Non-failure validation errors are reported to the sink with offsets in
+// the input (before ASCII tab or newline removal).
 // Returns validation_errc::ok on success, or an error value on parsing failure.
-template <typename CharT>
-inline validation_errc url_parser::url_parse(url_serializer& urls, const CharT* first, const CharT* last, const url* base, State state_override)
+template <typename CharT, class Sink>
+inline validation_errc url_parser::url_parse(url_serializer& urls, const CharT* first, const CharT* last, const url* base,
+    State state_override, State start_state, Sink&& sink)
 {
     using UCharT = typename std::make_unsigned<CharT>::type;
 
     // remove all ASCII tab or newline from URL
+    detail::validation_reporter<CharT, typename std::remove_reference<Sink>::type> warn(sink, first, last);
     simple_buffer<CharT> buff_no_ws;
     detail::do_remove_whitespace(first, last, buff_no_ws);
-    //TODO-WARN: validation error if removed
+    warn.set_origin(first);
 
     if (urls.need_save()) {
         // reserve size (TODO: But what if `base` is used?)
@@ -1611,10 +1849,12 @@ inline validation_errc url_parser::url_parse(url_serializer& urls, const CharT*
 #endif
 
     auto pointer = first;
-    State state = state_override ? state_override : scheme_start_state;
+    State state = state_override ? state_override
+        : start_state ? start_state : scheme_start_state;
 
     // has scheme?
     if (state == scheme_start_state) {
+        UPA_INSTRUMENT_STATE(scheme_start_state);
         if (pointer != last && detail::is_first_scheme_char(*pointer)) {
             state = scheme_state; // this appends first char to buffer
         } else if (!state_override) {
@@ -1626,6 +1866,7 @@ inline validation_errc url_parser::url_parse(url_serializer& urls, const CharT*
     }
 
     if (state == scheme_state) {
+        UPA_INSTRUMENT_STATE(scheme_state);
         // Deviation from URL stdandart's [ 2. ... if c is ":", run ... ] to
         // [ 2. ... if c is ":", or EOF and state override is given, run ... ]
         // This lets protocol setter to pass input without adding ':' to the end.
@@ -1679,7 +1920,9 @@ inline validation_errc url_parser::url_parse(url_serializer& urls, const CharT*
 
             pointer = end_of_scheme + 1; // skip ':'
             if (urls.is_file_scheme()) {
-                // TODO-WARN: if remaining does not start with "//", validation error.
+                // if remaining does not start with "//", validation error.
+                if (warn.enabled && !(last - pointer > 1 && pointer[0] == '/' && pointer[1] == '/'))
+                    warn(validation_errc::special_scheme_missing_following_solidus, pointer);
                 state = file_state;
             } else {
                 if (urls.is_special_scheme()) {
@@ -1712,6 +1955,7 @@ inline validation_errc url_parser::url_parse(url_serializer& urls, const CharT*
     }
 
     if (state == no_scheme_state) {
+        UPA_INSTRUMENT_STATE(no_scheme_state);
         if (base) {
             if (base->has_opaque_path()) {
                 if (pointer < last && *pointer == '#') {
@@ -1736,16 +1980,18 @@ inline validation_errc url_parser::url_parse(url_serializer& urls, const CharT*
     }
 
     if (state == special_relative_or_authority_state) {
+        UPA_INSTRUMENT_STATE(special_relative_or_authority_state);
         if (last - pointer > 1 && pointer[0] == '/' && pointer[1] == '/') {
             state = special_authority_ignore_slashes_state;
             pointer += 2; // skip "//"
         } else {
-            //TODO-WARN: validation error
+            if (warn.enabled) warn(validation_errc::special_scheme_missing_following_solidus, pointer);
             state = relative_state;
         }
     }
 
     if (state == path_or_authority_state) {
+        UPA_INSTRUMENT_STATE(path_or_authority_state);
         if (pointer < last && pointer[0] == '/') {
             state = authority_state;
             ++pointer; // skip "/"
@@ -1755,6 +2001,7 @@ inline validation_errc url_parser::url_parse(url_serializer& urls, const CharT*
     }
 
     if (state == relative_state) {
+        UPA_INSTRUMENT_STATE(relative_state);
         // std::assert(base != nullptr);
         urls.set_scheme(*base);
         if (pointer == last) {
@@ -1783,7 +2030,7 @@ inline validation_errc url_parser::url_parse(url_serializer& urls, const CharT*
             break;
         case '\\':
             if (urls.is_special_scheme()) {
-                //TODO-WARN: validation error
+                if (warn.enabled) warn(validation_errc::invalid_reverse_solidus, pointer);
                 state = relative_slash_state;
                 break;
             }
@@ -1798,6 +2045,7 @@ inline validation_errc url_parser::url_parse(url_serializer& urls, const CharT*
     }
 
     if (state == relative_slash_state) {
+        UPA_INSTRUMENT_STATE(relative_slash_state);
         // EOF ==> 0 ==> default:
         switch (pointer != last ? *pointer : 0) {
         case '/':
@@ -1809,7 +2057,7 @@ inline validation_errc url_parser::url_parse(url_serializer& urls, const CharT*
             break;
         case '\\':
             if (urls.is_special_scheme()) {
-                // TODO-WARN: validation error
+                if (warn.enabled) warn(validation_errc::invalid_reverse_solidus, pointer);
                 state = special_authority_ignore_slashes_state;
                 ++pointer;
                 break;
@@ -1824,19 +2072,22 @@ inline validation_errc url_parser::url_parse(url_serializer& urls, const CharT*
     }
 
     if (state == special_authority_slashes_state) {
+        UPA_INSTRUMENT_STATE(special_authority_slashes_state);
         if (last - pointer > 1 && pointer[0] == '/' && pointer[1] == '/') {
             state = special_authority_ignore_slashes_state;
             pointer += 2; // skip "//"
         } else {
-            //TODO-WARN: validation error
+            if (warn.enabled) warn(validation_errc::special_scheme_missing_following_solidus, pointer);
             state = special_authority_ignore_slashes_state;
         }
     }
 
     if (state == special_authority_ignore_slashes_state) {
+        UPA_INSTRUMENT_STATE(special_authority_ignore_slashes_state);
         auto it = pointer;
         while (it < last && detail::is_slash(*it)) ++it;
-        // if (it != pointer) // TODO-WARN: validation error
+        if (warn.enabled && it != pointer)
+            warn(validation_errc::special_scheme_missing_following_solidus, pointer);
         pointer = it;
         state = authority_state;
     }
@@ -1844,6 +2095,7 @@ inline validation_errc url_parser::url_parse(url_serializer& urls, const CharT*
     // TODO?: credentials serialization do after host parsing, because
     // if host is null, then no credentials serialization
     if (state == authority_state) {
+        UPA_INSTRUMENT_STATE(authority_state);
         // TODO: saugoti end_of_authority ir naudoti kituose state
         const auto end_of_authority = urls.is_special_scheme() ?
             std::find_if(pointer, last, detail::is_special_authority_end_char<CharT>) :
@@ -1857,7 +2109,7 @@ inline validation_errc url_parser::url_parse(url_serializer& urls, const CharT*
                 // Example: "http://u:p@/"
                 return validation_errc::host_missing;
             }
-            //TODO-WARN: validation error
+            if (warn.enabled) warn(validation_errc::invalid_credentials, pointer);
             if (urls.need_save()) {
                 const auto it_colon = std::find(pointer, it_eta, ':');
                 // url includes credentials?
@@ -1882,6 +2134,7 @@ inline validation_errc url_parser::url_parse(url_serializer& urls, const CharT*
     }
 
     if (state == host_state || state == hostname_state) {
+        UPA_INSTRUMENT_STATE(state);
         if (state_override && urls.is_file_scheme()) {
             state = file_host_state;
         } else {
@@ -1925,7 +2178,7 @@ inline validation_errc url_parser::url_parse(url_serializer& urls, const CharT*
                 return validation_errc::ignored; // host with port not accepted
 
             // parse and set host:
-            const auto res = parse_host(urls, pointer, it_host_end);
+            const auto res = parse_host(urls, pointer, it_host_end, warn);
             // 2.4, 3.4. If host is failure, then return failure.
             if (res != validation_errc::ok)
                 return res;
@@ -1943,6 +2196,7 @@ inline validation_errc url_parser::url_parse(url_serializer& urls, const CharT*
     }
 
     if (state == port_state) {
+        UPA_INSTRUMENT_STATE(port_state);
         const auto end_of_digits = std::find_if_not(pointer, last, detail::is_ascii_digit<CharT>);
 
         const bool is_end_of_authority =
@@ -1990,14 +2244,16 @@ inline validation_errc url_parser::url_parse(url_serializer& urls, const CharT*
     }
 
     if (state == file_state) {
+        UPA_INSTRUMENT_STATE(file_state);
         if (!urls.is_file_scheme())
             urls.set_scheme(string_view{ "file", 4 });
         // ensure file URL's host is not null
         urls.set_empty_host();
+        if (warn.enabled && pointer != last && *pointer == '\\')
+            warn(validation_errc::invalid_reverse_solidus, pointer);
         // EOF ==> 0 ==> default:
         switch (pointer != last ? *pointer : 0) {
         case '\\':
-            // TODO-WARN: validation error
         case '/':
             state = file_slash_state;
             ++pointer;
@@ -2030,7 +2286,7 @@ inline validation_errc url_parser::url_parse(url_serializer& urls, const CharT*
                         urls.append_parts(*base, url::HOST, url::PATH, &url::get_shorten_path);
                         // Note: This is a (platform-independent) Windows drive letter quirk.
                     } else {
-                        // TODO-WARN: validation error
+                        if (warn.enabled) warn(validation_errc::file_invalid_windows_drive_letter, pointer);
                         // set url's host to base's host
                         urls.append_parts(*base, url::HOST, url::HOST);
                     }
@@ -2043,10 +2299,12 @@ inline validation_errc url_parser::url_parse(url_serializer& urls, const CharT*
     }
 
     if (state == file_slash_state) {
+        UPA_INSTRUMENT_STATE(file_slash_state);
+        if (warn.enabled && pointer != last && *pointer == '\\')
+            warn(validation_errc::invalid_reverse_solidus, pointer);
         // EOF ==> 0 ==> default:
         switch (pointer != last ? *pointer : 0) {
         case '\\':
-            // TODO-WARN: validation error
         case '/':
             state = file_host_state;
             ++pointer;
@@ -2078,6 +2336,7 @@ inline validation_errc url_parser::url_parse(url_serializer& urls, const CharT*
     }
 
     if (state == file_host_state) {
+        UPA_INSTRUMENT_STATE(file_host_state);
         const auto end_of_authority = std::find_if(pointer, last, detail::is_special_authority_end_char<CharT>);
 
         if (pointer == end_of_authority) {
@@ -2091,14 +2350,14 @@ inline validation_errc url_parser::url_parse(url_serializer& urls, const CharT*
         } else if (!state_override && end_of_authority - pointer == 2 &&
             detail::is_windows_drive(pointer[0], pointer[1])) {
             // buffer is a Windows drive letter
-            // TODO-WARN: validation error
+            if (warn.enabled) warn(validation_errc::file_invalid_windows_drive_letter_host, pointer);
             state = path_state;
             // Note: This is a (platform - independent) Windows drive letter quirk.
             // buffer is not reset here and instead used in the path state.
             // TODO: buffer is not reset here and instead used in the path state
         } else {
             // parse and set host:
-            const auto res = parse_host(urls, pointer, end_of_authority);
+            const auto res = parse_host(urls, pointer, end_of_authority, warn);
             if (res != validation_errc::ok || !urls.need_save())
                 return res; // TODO-ERR: failure
             // if host is "localhost", then set host to the empty string
@@ -2118,11 +2377,14 @@ inline validation_errc url_parser::url_parse(url_serializer& urls, const CharT*
         return validation_errc::ok;
 
     if (state == path_start_state) {
+        UPA_INSTRUMENT_STATE(path_start_state);
         if (urls.is_special_scheme()) {
             if (pointer != last) {
                 switch (*pointer) {
                 case '\\':
-                    // TODO-WARN: validation error
+                    if (warn.enabled) warn(validation_errc::invalid_reverse_solidus, pointer);
+                    ++pointer;
+                    break;
                 case '/':
                     ++pointer;
                 }
@@ -2163,9 +2425,11 @@ inline validation_errc url_parser::url_parse(url_serializer& urls, const CharT*
     }
 
     if (state == path_state) {
+        UPA_INSTRUMENT_STATE(path_state);
         const auto end_of_path = state_override ? last :
             std::find_if(pointer, last, [](CharT c) { return c == '?' || c == '#'; });
 
+        if (warn.enabled) warn.check_url_units(pointer, end_of_path, urls.is_special_scheme());
         parse_path(urls, pointer, end_of_path);
         pointer = end_of_path;
 
@@ -2187,11 +2451,13 @@ inline validation_errc url_parser::url_parse(url_serializer& urls, const CharT*
     }
 
     if (state == opaque_path_state) {
+        UPA_INSTRUMENT_STATE(opaque_path_state);
         const auto end_of_path =
             std::find_if(pointer, last, [](CharT c) { return c == '?' || c == '#'; });
 
         // UTF-8 percent encode using the C0 control percent-encode set,
         // and append the result to url's path string
+        if (warn.enabled) warn.check_url_units(pointer, end_of_path, false);
         std::string& str_path = urls.start_path_string();
         do_simple_path(pointer, end_of_path, str_path);
         urls.save_path_string();
@@ -2212,14 +2478,12 @@ inline validation_errc url_parser::url_parse(url_serializer& urls, const CharT*
     }
 
     if (state == query_state) {
+        UPA_INSTRUMENT_STATE(query_state);
         const auto end_of_query = state_override ? last : std::find(pointer, last, '#');
 
-        // TODO-WARN:
-        //for (auto it = pointer; it < end_of_query; ++it) {
-        //  UCharT c = static_cast<UCharT>(*it);
-        //  // 1. If c is not a URL code point and not "%", validation error.
-        //  // 2. If c is "%" and remaining does not start with two ASCII hex digits, validation error.
-        //}
+        // 1. If c is not a URL code point and not "%", validation error.
+        // 2. If c is "%" and remaining does not start with two ASCII hex digits, validation error.
+        if (warn.enabled) warn.check_url_units(pointer, end_of_query, false);
 
 #ifdef UPA_URL_USE_ENCODING
         // scheme_inf_ == nullptr, if unknown scheme
@@ -2254,9 +2518,6 @@ inline validation_errc url_parser::url_parse(url_serializer& urls, const CharT*
                     str_query.push_back(uc);
                 ++pointer;
             }
-            // TODO-WARN:
-            // If c is not a URL code point and not "%", validation error.
-            // If c is "%" and remaining does not start with two ASCII hex digits, validation error.
             // Let bytes be the result of encoding c using encoding ...
         }
         urls.save_part();
@@ -2272,7 +2533,9 @@ inline validation_errc url_parser::url_parse(url_serializer& urls, const CharT*
     }
 
     if (state == fragment_state) {
+        UPA_INSTRUMENT_STATE(fragment_state);
         // https://url.spec.whatwg.org/#fragment-state
+        if (warn.enabled) warn.check_url_units(pointer, last, false);
         std::string& str_frag = urls.start_part(url::FRAGMENT);
         while (pointer < last) {
             // UTF-8 percent encode c using the fragment percent-encode set
@@ -2291,9 +2554,6 @@ inline validation_errc url_parser::url_parse(url_serializer& urls, const CharT*
                 }
                 ++pointer;
             }
-            // TODO-WARN:
-            // If c is not a URL code point and not "%", validation error.
-            // If c is "%" and remaining does not start with two ASCII hex digits, validation error.
         }
         urls.save_part();
         urls.set_flag(url::FRAGMENT_FLAG);
@@ -2304,9 +2564,11 @@ inline validation_errc url_parser::url_parse(url_serializer& urls, const CharT*
 
 // internal functions
 
-template <typename CharT>
-inline validation_errc url_parser::parse_host(url_serializer& urls, const CharT* first, const CharT* last) {
-    return host_parser::parse_host(first, last, !urls.is_special_scheme(), urls);
+template <typename CharT, class Reporter>
+inline validation_errc url_parser::parse_host(url_serializer& urls, const CharT* first, const CharT* last,
+    const Reporter& warn)
+{
+    return host_parser::parse_host(first, last, !urls.is_special_scheme(), urls, warn);
 }
 
 template <typename CharT>
@@ -2349,9 +2611,9 @@ inline void url_parser::parse_path(url_serializer& urls, const CharT* first, con
         // end_of_segment >= pointer
         const std::size_t len = end_of_segment - pointer;
         const bool is_last = end_of_segment == last;
-        // TODO-WARN: 1. If url is special and c is "\", validation error.
 
         if (double_dot(pointer, len)) {
+            UPA_INSTRUMENT_SLOW_PATH(path_shorten);
             urls.shorten_path();
             if (is_last) urls.append_empty_path_segment();
         } else if (single_dot(pointer, len)) {
@@ -2386,7 +2648,7 @@ template <typename CharT>
 inline bool url_parser::do_path_segment(const CharT* pointer, const CharT* last, std::string& output) {
     using UCharT = typename std::make_unsigned<CharT>::type;
 
-    // TODO-WARN: 2. [ 1 ... 2 ] validation error.
+    // validation errors of path code points are reported by url_parse
     bool success = true;
     while (pointer < last) {
         // UTF-8 percent encode c using the default encode set
@@ -2412,9 +2674,7 @@ inline bool url_parser::do_simple_path(const CharT* pointer, const CharT* last,
     using UCharT = typename std::make_unsigned<CharT>::type;
 
     // 3. of "opaque path state"
-    // TODO-WARN: 3. [ 1 ... 2 ] validation error.
-    //  1. If c is not EOF code point, not a URL code point, and not "%", validation error.
-    //  2. If c is "%" and remaining does not start with two ASCII hex digits, validation error.
+    // validation errors of code points are reported by url_parse
 
     bool success = true;
     while (pointer < last) {
@@ -2752,6 +3012,25 @@ inline void url_serializer::append_parts(const url& src, url::PartType t1, url::
     }
 }
 
+inline void url_serializer::copy_prefix(const url& src, url::PartType last_pt, std::size_t end, std::size_t path_segment_count) {
+    assert(last_pt_ == url::SCHEME && url_.empty());
+
+    if (!need_save()) return;
+
+    url_.norm_url_.append(src.norm_url_.data(), end);
+    unsigned mask = 0;
+    for (int ind = url::SCHEME; ind < last_pt; ++ind) {
+        url_.part_end_[ind] = src.part_end_[ind];
+        mask |= url::kPartFlagMask[ind];
+    }
+    url_.part_end_[last_pt] = end;
+    mask |= url::kPartFlagMask[last_pt];
+    url_.flags_ = (url_.flags_ & ~mask) | (src.flags_ & mask);
+    url_.scheme_inf_ = src.scheme_inf_;
+    url_.path_segment_count_ = path_segment_count;
+    last_pt_ = last_pt;
+}
+
 // replace part in url
 
 inline std::size_t url_serializer::get_part_pos(const url::PartType pt) const {
@@ -3110,6 +3389,9 @@ inline bool equals(const url& lhs, const url& rhs, bool exclude_fragments = fals
 
 /// @brief Lexicographically compares two URL's
 inline bool operator==(const url& lhs, const url& rhs) noexcept {
+    // different cached hashes mean different URLs
+    if (lhs.hash_ && rhs.hash_ && lhs.hash_ != rhs.hash_)
+        return false;
     return lhs.norm_url_ == rhs.norm_url_;
 }
 
@@ -3313,10 +3595,13 @@ inline std::string path_from_file_url(const url& file_url, file_path_format form
 namespace std {
 
 /// @brief std::hash specialization for upa::url class
+///
+/// Uses the hash value cached by the parser; it is recalculated only for
+/// URLs changed by setters after parsing.
 template<>
 struct hash<upa::url> {
     std::size_t operator()(const upa::url& url) const noexcept {
-        return std::hash<std::string>{}(url.norm_url_);
+        return static_cast<std::size_t>(url.hash_value());
     }
 };
 
@@ -3324,5 +3609,9 @@ struct hash<upa::url> {
 
 // Includes that require the url class declaration
 #include "url_search_params-inl.h"
+#include "url_builder.h"
+#include "url_resolver.h"
+#include "url_hash.h"
+#include "url_origin.h"
 
 #endif // UPA_URL_H
@@ -0,0 +1,450 @@
+// Copyright 2016-2024 Rimas Misevičius
+// Distributed under the BSD-style license that can be
+// found in the LICENSE file.
+//
+// This file is included at the end of url.h, but it can also be
+// included on its own.
+//
+
+#ifndef UPA_URL_BUILDER_H
+#define UPA_URL_BUILDER_H
+
+#include "url.h"
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <string>
+
+namespace upa {
+
+/// @brief Changes several components of the URL at once
+///
+/// Collects new component values and applies them to the URL in one pass:
+/// the new URL string and part offsets are serialized once, instead of
+/// splicing the URL string on each setter call. Each value is validated by
+/// the same state override parser as the corresponding setter of the
+/// upa::url class, so the result is the same as calling the setters in this
+/// order: protocol, username, password, host (or hostname), port, pathname,
+/// search, hash.
+///
+/// Example:
+/// @code
+/// upa::url_builder b;
+/// b.host("example.org").pathname("/docs").search("q=1");
+/// b.apply(u);
+/// @endcode
+class url_builder {
+public:
+    /// Default constructor: no components to change
+    url_builder() = default;
+
+    /// Sets the new protocol (scheme)
+    /// @param[in] str the same input as for url::protocol(StrT&& str)
+    template <class StrT, enable_if_str_arg_t<StrT> = 0>
+    url_builder& protocol(StrT&& str);
+
+    /// Sets the new username
+    /// @param[in] str the same input as for url::username(StrT&& str)
+    template <class StrT, enable_if_str_arg_t<StrT> = 0>
+    url_builder& username(StrT&& str);
+
+    /// Sets the new password
+    /// @param[in] str the same input as for url::password(StrT&& str)
+    template <class StrT, enable_if_str_arg_t<StrT> = 0>
+    url_builder& password(StrT&& str);
+
+    /// Sets the new host and optionally port; replaces the value set by hostname(...)
+    /// @param[in] str the same input as for url::host(StrT&& str)
+    template <class StrT, enable_if_str_arg_t<StrT> = 0>
+    url_builder& host(StrT&& str);
+
+    /// Sets the new hostname; replaces the value set by host(...)
+    /// @param[in] str the same input as for url::hostname(StrT&& str)
+    template <class StrT, enable_if_str_arg_t<StrT> = 0>
+    url_builder& hostname(StrT&& str);
+
+    /// Sets the new port
+    /// @param[in] str the same input as for url::port(StrT&& str)
+    template <class StrT, enable_if_str_arg_t<StrT> = 0>
+    url_builder& port(StrT&& str);
+
+    /// Sets the new path
+    /// @param[in] str the same input as for url::pathname(StrT&& str)
+    template <class StrT, enable_if_str_arg_t<StrT> = 0>
+    url_builder& pathname(StrT&& str);
+
+    /// Sets the new query
+    /// @param[in] str the same input as for url::search(StrT&& str)
+    template <class StrT, enable_if_str_arg_t<StrT> = 0>
+    url_builder& search(StrT&& str);
+
+    /// Sets the new fragment
+    /// @param[in] str the same input as for url::hash(StrT&& str)
+    template <class StrT, enable_if_str_arg_t<StrT> = 0>
+    url_builder& hash(StrT&& str);
+
+    /// Forgets all collected component values
+    void clear() noexcept;
+
+    /// @return `true` if there are no component values to apply
+    bool empty() const noexcept;
+
+    /// @brief Applies collected component values to the URL
+    ///
+    /// Values the corresponding setter would ignore or reject are not
+    /// applied, the same as with setters. The URL is left unchanged if it
+    /// is invalid.
+    ///
+    /// @param[in,out] dest URL to change
+    /// @return `true` if every component value was applied (i.e. each
+    ///   corresponding setter would return `true`), `false` otherwise
+    bool apply(url& dest) const;
+
+private:
+    enum Component : unsigned {
+        PROTOCOL = 0,
+        USERNAME,
+        PASSWORD,
+        HOST,
+        PORT,
+        PATHNAME,
+        SEARCH,
+        HASH,
+        COMPONENT_COUNT
+    };
+
+    template <class StrT>
+    url_builder& set_value(Component c, StrT&& str);
+
+    bool has_value(Component c) const noexcept {
+        return (mask_ & (1u << c)) != 0;
+    }
+    bool has_any_value(Component c1, Component c2) const noexcept {
+        return (mask_ & (((1u << (c2 + 1)) - 1) & ~((1u << c1) - 1))) != 0;
+    }
+
+    bool build(const url& src, url& res) const;
+
+private:
+    std::array<std::string, COMPONENT_COUNT> values_;
+    unsigned mask_ = 0;
+    bool is_hostname_ = false;
+};
+
+
+namespace detail {
+
+// URL serializer used by the url_builder. It serializes URL parts to the
+// new URL record in the same way as url_serializer does, but keeps flags of
+// the source URL for parts not serialized yet (the state override checks
+// depend on them), and can discard the part that failed to parse.
+
+class url_builder_serializer : public url_serializer {
+public:
+    struct mark {
+        std::size_t length;
+        url::PartType last_pt;
+        unsigned flags;
+    };
+
+    url_builder_serializer(url& dest_url, const url& src_url, std::size_t new_cap)
+        : url_serializer(dest_url)
+    {
+        url_.norm_url_.reserve(new_cap);
+        url_.flags_ = src_url.flags_;
+        set_scheme(src_url);
+    }
+
+    // the new URL record is complete
+    ~url_builder_serializer() override { url_.update_hash(); }
+
+    // the memory is reserved once in the constructor
+    void reserve(std::size_t /*new_cap*/) override {}
+
+    // parts are appended in order, so the part to clear is not serialized yet
+    void clear_part(const url::PartType pt) override {
+        assert(last_pt_ < pt);
+        url_.flags_ &= ~(1u << pt); // set to null
+    }
+
+    url::PartType last_part() const noexcept { return last_pt_; }
+
+    mark get_mark() const noexcept {
+        return { url_.norm_url_.length(), last_pt_, url_.flags_ };
+    }
+    void rollback(const mark& m) noexcept {
+        url_.norm_url_.resize(m.length);
+        for (int ind = m.last_pt + 1; ind < url::PART_COUNT; ++ind)
+            url_.part_end_[ind] = 0;
+        last_pt_ = m.last_pt;
+        url_.flags_ = m.flags;
+    }
+
+    // removes the port serialized together with the host and returns it;
+    // the port flag is left unchanged
+    std::string take_port() {
+        assert(last_pt_ == url::PORT);
+        const auto port = url_.get_part_view(url::PORT);
+        std::string str_port(port.data(), port.length());
+        url_.norm_url_.resize(url_.part_end_[url::HOST]);
+        url_.part_end_[url::PORT] = 0;
+        last_pt_ = url::HOST;
+        return str_port;
+    }
+
+    void append_port(const std::string& str_port) {
+        start_part(url::PORT) += str_port;
+        save_part();
+        set_flag(url::PORT_FLAG);
+    }
+
+    // https://url.spec.whatwg.org/#potentially-strip-trailing-spaces-from-an-opaque-path
+    // Called when the query or fragment is set to null; at this point the
+    // path is the last serialized part.
+    void potentially_strip_trailing_spaces_from_an_opaque_path() {
+        if (url_.has_opaque_path() &&
+            is_null(url::FRAGMENT) &&
+            is_null(url::QUERY)) {
+            assert(last_pt_ == url::PATH);
+            const auto newlen = url_.norm_url_.find_last_not_of(' ') + 1;
+            url_.norm_url_.resize(newlen);
+            url_.part_end_[url::PATH] = newlen;
+        }
+    }
+};
+
+} // namespace detail
+
+
+// url_builder class
+
+template <class StrT>
+inline url_builder& url_builder::set_value(const Component c, StrT&& str) {
+    const auto value = make_string(std::forward<StrT>(str));
+    values_[c].assign(value.data(), value.length());
+    mask_ |= (1u << c);
+    return *this;
+}
+
+template <class StrT, enable_if_str_arg_t<StrT>>
+inline url_builder& url_builder::protocol(StrT&& str) {
+    return set_value(PROTOCOL, std::forward<StrT>(str));
+}
+
+template <class StrT, enable_if_str_arg_t<StrT>>
+inline url_builder& url_builder::username(StrT&& str) {
+    return set_value(USERNAME, std::forward<StrT>(str));
+}
+
+template <class StrT, enable_if_str_arg_t<StrT>>
+inline url_builder& url_builder::password(StrT&& str) {
+    return set_value(PASSWORD, std::forward<StrT>(str));
+}
+
+template <class StrT, enable_if_str_arg_t<StrT>>
+inline url_builder& url_builder::host(StrT&& str) {
+    is_hostname_ = false;
+    return set_value(HOST, std::forward<StrT>(str));
+}
+
+template <class StrT, enable_if_str_arg_t<StrT>>
+inline url_builder& url_builder::hostname(StrT&& str) {
+    is_hostname_ = true;
+    return set_value(HOST, std::forward<StrT>(str));
+}
+
+template <class StrT, enable_if_str_arg_t<StrT>>
+inline url_builder& url_builder::port(StrT&& str) {
+    return set_value(PORT, std::forward<StrT>(str));
+}
+
+template <class StrT, enable_if_str_arg_t<StrT>>
+inline url_builder& url_builder::pathname(StrT&& str) {
+    return set_value(PATHNAME, std::forward<StrT>(str));
+}
+
+template <class StrT, enable_if_str_arg_t<StrT>>
+inline url_builder& url_builder::search(StrT&& str) {
+    return set_value(SEARCH, std::forward<StrT>(str));
+}
+
+template <class StrT, enable_if_str_arg_t<StrT>>
+inline url_builder& url_builder::hash(StrT&& str) {
+    return set_value(HASH, std::forward<StrT>(str));
+}
+
+inline void url_builder::clear() noexcept {
+    for (auto& value : values_)
+        value.clear();
+    mask_ = 0;
+    is_hostname_ = false;
+}
+
+inline bool url_builder::empty() const noexcept {
+    return mask_ == 0;
+}
+
+inline bool url_builder::apply(url& dest) const {
+    if (!dest.is_valid())
+        return false;
+    if (empty())
+        return true;
+
+    bool res = true;
+    // The protocol setter can change the port, and the scheme affects the
+    // serialization of all other parts, so it is applied first
+    url src_protocol;
+    const url* src = &dest;
+    if (has_value(PROTOCOL)) {
+        src_protocol = dest;
+        res = src_protocol.protocol(values_[PROTOCOL]);
+        src = &src_protocol;
+    }
+
+    url u;
+    res = build(*src, u) && res;
+    dest.safe_assign(std::move(u));
+    return res;
+}
+
+inline bool url_builder::build(const url& src, url& res) const {
+    using detail::url_parser;
+
+    const auto parse = [](detail::url_serializer& urls, const std::string& str,
+        std::size_t offset, url_parser::State state) {
+        return url_parser::url_parse(urls, str.data() + offset, str.data() + str.length(),
+            nullptr, state);
+    };
+
+    bool ok = true;
+
+    std::size_t new_cap = src.norm_url_.length();
+    for (const auto& value : values_)
+        new_cap += value.length();
+    detail::url_builder_serializer urls(res, src, new_cap);
+
+    // username, password, host, port
+    if (!has_any_value(USERNAME, PORT)) {
+        urls.append_parts(src, url::USERNAME, url::PORT);
+    } else {
+        // credentials
+        const bool can_have_credentials = src.canHaveUsernamePasswordPort();
+        const bool set_username = has_value(USERNAME) && can_have_credentials;
+        const bool set_password = has_value(PASSWORD) && can_have_credentials;
+        if (has_value(USERNAME) != set_username || has_value(PASSWORD) != set_password)
+            ok = false;
+        if (set_username || set_password) {
+            const bool is_empty_username = set_username
+                ? values_[USERNAME].empty()
+                : src.is_empty(url::USERNAME);
+            const bool is_empty_password = set_password
+                ? values_[PASSWORD].empty()
+                : src.is_empty(url::PASSWORD);
+            const auto append_userinfo = [&](url::PartType pt, bool set_value, const std::string& value) {
+                std::string& str_userinfo = urls.start_part(pt);
+                if (set_value) {
+                    // UTF-8 percent encode it using the userinfo encode set
+                    detail::append_utf8_percent_encoded(value.data(), value.data() + value.length(),
+                        userinfo_no_encode_set, str_userinfo);
+                } else {
+                    util::append(str_userinfo, src.get_part_view(pt));
+                }
+                urls.save_part();
+            };
+            if (!is_empty_username || !is_empty_password) {
+                append_userinfo(url::USERNAME, set_username, values_[USERNAME]);
+                if (!is_empty_password)
+                    append_userinfo(url::PASSWORD, set_password, values_[PASSWORD]);
+            }
+        } else {
+            urls.append_parts(src, url::USERNAME, url::PASSWORD);
+        }
+
+        // host
+        if (has_value(HOST) && !src.has_opaque_path()) {
+            const auto m = urls.get_mark();
+            const auto rv = parse(urls, values_[HOST], 0,
+                is_hostname_ ? url_parser::hostname_state : url_parser::host_state);
+            if (rv != validation_errc::ok) {
+                ok = false;
+                // the host is set even if the port after it is out of range
+                if (rv != validation_errc::port_out_of_range) {
+                    urls.rollback(m);
+                    urls.append_parts(src, url::HOST, url::HOST);
+                }
+            }
+        } else {
+            if (has_value(HOST))
+                ok = false;
+            urls.append_parts(src, url::HOST, url::HOST);
+        }
+
+        // port
+        std::string str_port;
+        if (urls.last_part() == url::PORT) {
+            // the port was set by the host value
+            str_port = urls.take_port();
+        } else if (!res.is_null(url::PORT)) {
+            const auto port = src.get_part_view(url::PORT);
+            str_port.assign(port.data(), port.length());
+        }
+        if (has_value(PORT)) {
+            if (res.canHaveUsernamePasswordPort()) {
+                if (values_[PORT].empty())
+                    urls.clear_part(url::PORT);
+                else if (parse(urls, values_[PORT], 0, url_parser::port_state) != validation_errc::ok)
+                    ok = false;
+            } else {
+                ok = false;
+            }
+        }
+        // if the port is not changed, then restore it
+        if (urls.last_part() < url::PORT && !res.is_null(url::PORT))
+            urls.append_port(str_port);
+    }
+
+    // path
+    if (has_value(PATHNAME) && !src.has_opaque_path()) {
+        parse(urls, values_[PATHNAME], 0, url_parser::path_start_state);
+    } else {
+        if (has_value(PATHNAME))
+            ok = false;
+        urls.append_parts(src, url::PATH_PREFIX, url::PATH);
+        // the "/." path prefix depends on the host
+        urls.commit_path();
+    }
+
+    // query
+    if (has_value(SEARCH)) {
+        const auto& value = values_[SEARCH];
+        if (value.empty()) {
+            urls.clear_part(url::QUERY);
+            urls.potentially_strip_trailing_spaces_from_an_opaque_path();
+        } else {
+            parse(urls, value, value[0] == '?' ? 1 : 0, url_parser::query_state);
+        }
+    } else if (!src.is_null(url::QUERY)) {
+        // append_parts can not copy a single null part
+        urls.append_parts(src, url::QUERY, url::QUERY);
+    }
+
+    // fragment
+    if (has_value(HASH)) {
+        const auto& value = values_[HASH];
+        if (value.empty()) {
+            urls.clear_part(url::FRAGMENT);
+            urls.potentially_strip_trailing_spaces_from_an_opaque_path();
+        } else {
+            parse(urls, value, value[0] == '#' ? 1 : 0, url_parser::fragment_state);
+        }
+    } else if (!src.is_null(url::FRAGMENT)) {
+        urls.append_parts(src, url::FRAGMENT, url::FRAGMENT);
+    }
+
+    return ok;
+}
+
+
+} // namespace upa
+
+#endif // UPA_URL_BUILDER_H
@@ -0,0 +1,498 @@
+// Copyright 2016-2024 Rimas Misevičius
+// Distributed under the BSD-style license that can be
+// found in the LICENSE file.
+//
+
+#ifndef UPA_URL_CORPUS_H
+#define UPA_URL_CORPUS_H
+
+#include "url.h"
+#include "url_record.h"
+#include "util.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace upa {
+namespace detail {
+
+// URL corpus format
+//
+//   header  "UPAC" magic, version byte
+//   blocks  up to block_size records each, followed by the 4 bytes
+//           checksum of the block
+//   index   8 bytes offset of each block
+//   footer  8 bytes index offset, 8 bytes number of records, 4 bytes block
+//           size, 4 bytes checksum of the index and the preceding footer
+//           fields, "UPAC" magic
+//
+// Record:
+//   varint  length of the prefix shared with the previous serialized URL
+//           (0 for the first record in the block)
+//   varint  length of the rest of serialized URL
+//   bytes   the rest of serialized URL
+//   ...     the record's tail as encoded by url_record::encode_tail
+//   byte    scheme id
+//
+// Fixed size numbers are little endian; checksum is url_record::checksum
+// (32-bit FNV-1a hash).
+
+struct url_corpus_format {
+    enum : std::size_t {
+        kVersion = 2,
+        kHeaderSize = 5,
+        kFooterSize = 28
+    };
+
+    static string_view magic() noexcept { return { "UPAC", 4 }; }
+
+    static void append_fixed(std::string& out, std::uint64_t value, int size) {
+        for (int i = 0; i < size; ++i)
+            out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+    }
+
+    static std::uint64_t read_fixed(const char* ptr, int size) noexcept {
+        std::uint64_t value = 0;
+        for (int i = 0; i < size; ++i)
+            value |= static_cast<std::uint64_t>(static_cast<unsigned char>(ptr[i])) << (8 * i);
+        return value;
+    }
+
+    static std::uint32_t checksum(const char* first, const char* last) noexcept {
+        return url_record::checksum(first, last);
+    }
+};
+
+// Sequentially decodes records of one block
+
+class url_corpus_block_reader {
+public:
+    url_corpus_block_reader(const char* first, const char* last) noexcept
+        : ptr_(first), last_(last)
+    {}
+
+    bool at_end() const noexcept { return ptr_ == last_; }
+
+    // Decodes the next serialized URL only
+    bool next_key() {
+        std::uint64_t shared, len;
+        if (!url_record::decode_varint(ptr_, last_, shared) || shared > key_.length() ||
+            !url_record::decode_varint(ptr_, last_, len) ||
+            len > static_cast<std::uint64_t>(last_ - ptr_))
+            return false;
+        key_.resize(static_cast<std::size_t>(shared));
+        key_.append(ptr_, static_cast<std::size_t>(len));
+        ptr_ += len;
+        return true;
+    }
+
+    // Decodes the rest of record, after the next_key()
+    bool next_tail(url_record_view& rec, unsigned& scheme_id) noexcept {
+        rec.norm_url = key_;
+        if (!url_record::decode_tail(ptr_, last_, rec) || ptr_ == last_)
+            return false;
+        scheme_id = static_cast<unsigned char>(*ptr_++);
+        return true;
+    }
+
+    // Skips the rest of record, after the next_key()
+    bool skip_tail() noexcept {
+        url_record_view rec;
+        unsigned scheme_id;
+        return next_tail(rec, scheme_id);
+    }
+
+    const std::string& key() const noexcept { return key_; }
+
+private:
+    const char* ptr_;
+    const char* last_;
+    std::string key_;
+};
+
+} // namespace detail
+
+
+/// @brief Writes sorted URL corpus
+///
+/// URLs must be added in increasing order of their serialized form
+/// (`url::href()`, compared byte by byte). Serialized URLs are front coded:
+/// each one stores only the bytes that differ from the previous URL. URLs
+/// are grouped in blocks, and the corpus contains the index of block
+/// offsets, so upa::url_corpus can access URLs by ordinal and find URLs
+/// by prefix, decoding only one block.
+///
+/// Each block and the index are protected by checksums.
+class url_corpus_writer {
+public:
+    /// @brief Constructor
+    /// @param[in] block_size max number of URLs in a block (at least 1)
+    explicit url_corpus_writer(std::size_t block_size = 16);
+
+    /// @brief Adds URL to the corpus
+    ///
+    /// @param[in] u URL to add
+    /// @return `true` if URL was added, `false` if its serialized form is not
+    ///   greater than the one of the previously added URL
+    bool add(const url& u);
+
+    /// @return number of added URLs
+    std::size_t size() const noexcept { return count_; }
+
+    /// @brief Finishes the corpus
+    ///
+    /// The writer is reset to empty state, and it can be used to write
+    /// another corpus.
+    ///
+    /// @return corpus bytes
+    std::string finish();
+
+private:
+    void reset();
+    void end_block();
+
+private:
+    std::size_t block_size_;
+    std::size_t count_ = 0;
+    std::size_t block_start_ = 0;
+    std::string data_;
+    std::vector<std::uint64_t> block_offsets_;
+    // the last added serialized URL
+    std::string prev_;
+};
+
+/// @brief Reads URL corpus
+///
+/// Reads corpus written by upa::url_corpus_writer. URLs are decoded without
+/// reparsing. The corpus bytes are not copied, so they must outlive the
+/// url_corpus object.
+class url_corpus {
+public:
+    /// @brief Default constructor
+    ///
+    /// Constructs empty corpus.
+    url_corpus() = default;
+
+    /// @brief Opens corpus
+    ///
+    /// Checks the corpus header, footer and index. The blocks are checked
+    /// when they are decoded.
+    ///
+    /// @param[in] data corpus bytes
+    /// @return `true` on success, `false` if the corpus is corrupted (then
+    ///   this object becomes empty)
+    bool open(string_view data);
+
+    /// @return number of URLs
+    std::size_t size() const noexcept { return count_; }
+
+    /// @return `true` if corpus has no URLs
+    bool empty() const noexcept { return count_ == 0; }
+
+    /// @brief Decodes URL by its ordinal
+    ///
+    /// @param[in]  ordinal URL's ordinal (the index in the sorted order)
+    /// @param[out] out     decoded URL
+    /// @return `true` on success, `false` if @a ordinal is out of range or
+    ///   the block is corrupted
+    bool get(std::size_t ordinal, url& out) const;
+
+    /// @brief Finds the first URL whose serialized form is not less than @a key
+    ///
+    /// @param[in] key serialized URL or its prefix
+    /// @return ordinal of the found URL, or size() if there is no such URL
+    std::size_t lower_bound(string_view key) const;
+
+    /// @brief Finds URLs whose serialized form starts with @a prefix
+    ///
+    /// For example, the "https://host/path/" prefix selects all URLs under
+    /// this path.
+    ///
+    /// @param[in] prefix prefix of the serialized URL
+    /// @return range of ordinals [first, last)
+    std::pair<std::size_t, std::size_t> prefix_range(string_view prefix) const;
+
+    /// @brief Decodes URLs in the range of ordinals
+    ///
+    /// @param[in] first, last range of ordinals
+    /// @param[in] fn function object to call for each decoded URL, with the
+    ///   signature `void(const upa::url&)`
+    /// @return `true` on success, `false` if the range is out of bounds or
+    ///   a block is corrupted
+    template <class Fn>
+    bool scan(std::size_t first, std::size_t last, Fn&& fn) const;
+
+    /// @brief Decodes URLs whose serialized form starts with @a prefix
+    ///
+    /// @param[in] prefix prefix of the serialized URL
+    /// @param[in] fn function object to call for each decoded URL, with the
+    ///   signature `void(const upa::url&)`
+    /// @return `true` on success, `false` if a block is corrupted
+    template <class Fn>
+    bool scan_prefix(string_view prefix, Fn&& fn) const {
+        const auto range = prefix_range(prefix);
+        return scan(range.first, range.second, std::forward<Fn>(fn));
+    }
+
+private:
+    std::size_t block_count() const noexcept { return index_size_; }
+    std::uint64_t block_offset(std::size_t ind) const noexcept;
+    // block records without checksum
+    bool block_range(std::size_t ind, const char*& first, const char*& last) const noexcept;
+    string_view block_first_key(std::size_t ind) const noexcept;
+
+private:
+    string_view data_;
+    const char* index_ = nullptr;
+    std::size_t index_size_ = 0;
+    std::size_t index_offset_ = 0;
+    std::size_t count_ = 0;
+    std::size_t block_size_ = 1;
+};
+
+
+// url_corpus_writer class
+
+inline url_corpus_writer::url_corpus_writer(std::size_t block_size)
+    : block_size_(std::max<std::size_t>(block_size, 1))
+{
+    reset();
+}
+
+inline bool url_corpus_writer::add(const url& u) {
+    const string_view href = u.href();
+    if (count_ && string_view(prev_).compare(href) >= 0)
+        return false;
+
+    const bool first_in_block = count_ % block_size_ == 0;
+    if (first_in_block) {
+        block_start_ = data_.length();
+        block_offsets_.push_back(block_start_);
+    }
+
+    // the length of the prefix shared with the previous URL
+    std::size_t shared = 0;
+    if (!first_in_block) {
+        const std::size_t len = std::min(prev_.length(), href.length());
+        while (shared < len && prev_[shared] == href[shared])
+            ++shared;
+    }
+
+    char buff[detail::url_record::kMaxOverhead];
+    data_.append(buff, detail::url_record::encode_varint(shared, buff));
+    data_.append(buff, detail::url_record::encode_varint(href.length() - shared, buff));
+    data_.append(href.data() + shared, href.length() - shared);
+    data_.append(buff, detail::url_record::encode_tail(u, buff));
+    data_.push_back(static_cast<char>(detail::url_record::scheme_id(u)));
+
+    prev_.assign(href.data(), href.length());
+    ++count_;
+    if (count_ % block_size_ == 0)
+        end_block();
+    return true;
+}
+
+inline std::string url_corpus_writer::finish() {
+    using fmt = detail::url_corpus_format;
+
+    if (count_ % block_size_ != 0)
+        end_block();
+    // index
+    const std::size_t index_offset = data_.length();
+    for (const auto offset : block_offsets_)
+        fmt::append_fixed(data_, offset, 8);
+    // footer
+    fmt::append_fixed(data_, index_offset, 8);
+    fmt::append_fixed(data_, count_, 8);
+    fmt::append_fixed(data_, block_size_, 4);
+    fmt::append_fixed(data_, fmt::checksum(data_.data() + index_offset, data_.data() + data_.length()), 4);
+    util::append(data_, fmt::magic());
+
+    std::string res;
+    res.swap(data_);
+    reset();
+    return res;
+}
+
+inline void url_corpus_writer::reset() {
+    using fmt = detail::url_corpus_format;
+
+    count_ = 0;
+    block_offsets_.clear();
+    prev_.clear();
+    data_.clear();
+    util::append(data_, fmt::magic());
+    data_.push_back(static_cast<char>(fmt::kVersion));
+}
+
+inline void url_corpus_writer::end_block() {
+    using fmt = detail::url_corpus_format;
+    fmt::append_fixed(data_, fmt::checksum(data_.data() + block_start_, data_.data() + data_.length()), 4);
+}
+
+
+// url_corpus class
+
+inline bool url_corpus::open(string_view data) {
+    using fmt = detail::url_corpus_format;
+
+    *this = url_corpus{};
+    if (data.length() < fmt::kHeaderSize + fmt::kFooterSize ||
+        string_view(data.data(), 4) != fmt::magic() ||
+        static_cast<unsigned char>(data[4]) != fmt::kVersion ||
+        string_view(data.data() + data.length() - 4, 4) != fmt::magic())
+        return false;
+
+    const char* footer = data.data() + data.length() - fmt::kFooterSize;
+    const std::uint64_t index_offset = fmt::read_fixed(footer, 8);
+    const std::uint64_t count = fmt::read_fixed(footer + 8, 8);
+    const std::uint64_t block_size = fmt::read_fixed(footer + 16, 4);
+    const auto checksum = static_cast<std::uint32_t>(fmt::read_fixed(footer + 20, 4));
+
+    const std::size_t footer_offset = data.length() - fmt::kFooterSize;
+    if (index_offset < fmt::kHeaderSize || index_offset > footer_offset ||
+        (footer_offset - index_offset) % 8 != 0 || block_size == 0)
+        return false;
+    const std::size_t index_size = (footer_offset - index_offset) / 8;
+    // each block except the last one has block_size records
+    if (count == 0 ? index_size != 0 : (count - 1) / block_size + 1 != index_size)
+        return false;
+    if (checksum != fmt::checksum(data.data() + index_offset, footer + 20))
+        return false;
+
+    // blocks follow the header, and each has at least the checksum
+    const char* index = data.data() + index_offset;
+    std::uint64_t prev_offset = 0;
+    for (std::size_t ind = 0; ind < index_size; ++ind) {
+        const std::uint64_t offset = fmt::read_fixed(index + ind * 8, 8);
+        if (ind == 0 ? offset != fmt::kHeaderSize : offset < prev_offset + 4)
+            return false;
+        prev_offset = offset;
+    }
+    if (index_size ? index_offset < prev_offset + 4 : index_offset != fmt::kHeaderSize)
+        return false;
+
+    data_ = data;
+    index_ = index;
+    index_size_ = index_size;
+    index_offset_ = static_cast<std::size_t>(index_offset);
+    count_ = static_cast<std::size_t>(count);
+    block_size_ = static_cast<std::size_t>(block_size);
+    return true;
+}
+
+inline bool url_corpus::get(std::size_t ordinal, url& out) const {
+    bool found = false;
+    return scan(ordinal, ordinal + 1, [&](const url& u) {
+        out = u;
+        found = true;
+    }) && found;
+}
+
+inline std::size_t url_corpus::lower_bound(string_view key) const {
+    // find the first block whose first key is greater than the key
+    std::size_t lo = 0, hi = block_count();
+    while (lo < hi) {
+        const std::size_t mid = lo + (hi - lo) / 2;
+        if (key.compare(block_first_key(mid)) < 0)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    if (lo == 0)
+        return 0;
+
+    // search in the previous block
+    const std::size_t block_ind = lo - 1;
+    const char* first;
+    const char* last;
+    std::size_t ordinal = block_ind * block_size_;
+    if (block_range(block_ind, first, last)) {
+        detail::url_corpus_block_reader reader(first, last);
+        while (!reader.at_end() && reader.next_key()) {
+            if (string_view(reader.key()).compare(key) >= 0)
+                return ordinal;
+            if (!reader.skip_tail())
+                break;
+            ++ordinal;
+        }
+    }
+    return std::min(lo * block_size_, count_);
+}
+
+inline std::pair<std::size_t, std::size_t> url_corpus::prefix_range(string_view prefix) const {
+    const std::size_t first = lower_bound(prefix);
+    // the smallest string greater than all strings with the prefix
+    std::string next(prefix.data(), prefix.length());
+    while (!next.empty() && static_cast<unsigned char>(next.back()) == 0xFF)
+        next.pop_back();
+    if (next.empty())
+        return { first, count_ };
+    next.back() = static_cast<char>(static_cast<unsigned char>(next.back()) + 1);
+    return { first, lower_bound(next) };
+}
+
+template <class Fn>
+inline bool url_corpus::scan(std::size_t first, std::size_t last, Fn&& fn) const {
+    if (first > last || last > count_)
+        return false;
+    url u;
+    for (std::size_t block_ind = first / block_size_; first < last; ++block_ind) {
+        const char* bfirst;
+        const char* blast;
+        if (!block_range(block_ind, bfirst, blast) ||
+            detail::url_corpus_format::checksum(bfirst, blast) !=
+            detail::url_corpus_format::read_fixed(blast, 4))
+            return false;
+
+        detail::url_corpus_block_reader reader(bfirst, blast);
+        std::size_t ordinal = block_ind * block_size_;
+        for (; ordinal < first; ++ordinal) {
+            if (!reader.next_key() || !reader.skip_tail())
+                return false;
+        }
+        const std::size_t block_last = std::min(last, (block_ind + 1) * block_size_);
+        for (; first < block_last; ++first) {
+            detail::url_record_view rec;
+            unsigned scheme_id;
+            if (!reader.next_key() || !reader.next_tail(rec, scheme_id) ||
+                !detail::url_record::assign_checked(u, rec, scheme_id))
+                return false;
+            fn(static_cast<const url&>(u));
+        }
+    }
+    return true;
+}
+
+inline std::uint64_t url_corpus::block_offset(std::size_t ind) const noexcept {
+    return detail::url_corpus_format::read_fixed(index_ + ind * 8, 8);
+}
+
+inline bool url_corpus::block_range(std::size_t ind, const char*& first, const char*& last) const noexcept {
+    if (ind >= block_count())
+        return false;
+    // open() checked offsets
+    first = data_.data() + block_offset(ind);
+    last = data_.data() + (ind + 1 < block_count() ? block_offset(ind + 1) : index_offset_) - 4;
+    return true;
+}
+
+inline string_view url_corpus::block_first_key(std::size_t ind) const noexcept {
+    const char* first;
+    const char* last;
+    std::uint64_t shared, len;
+    if (block_range(ind, first, last) &&
+        detail::url_record::decode_varint(first, last, shared) && shared == 0 &&
+        detail::url_record::decode_varint(first, last, len) &&
+        len <= static_cast<std::uint64_t>(last - first))
+        return { first, static_cast<std::size_t>(len) };
+    return {};
+}
+
+
+} // namespace upa
+
+#endif // UPA_URL_CORPUS_H
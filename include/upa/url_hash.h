@@ -0,0 +1,144 @@
+// Copyright 2016-2024 Rimas Misevičius
+// Distributed under the BSD-style license that can be
+// found in the LICENSE file.
+//
+// This file is included at the end of url.h, but it can also be
+// included on its own.
+//
+
+#ifndef UPA_URL_HASH_H
+#define UPA_URL_HASH_H
+
+#include "url.h"
+#include "util.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+namespace upa {
+namespace detail {
+
+// Access to URL's parts as ranges of the serialized URL
+
+struct url_parts {
+    // Returns the URL's part together with its leading delimiter (for example
+    // ":" of the port, "?" of the query); it is empty if the part is null.
+    // Consecutive parts are adjacent in the serialized URL.
+    static string_view span(const url& u, url::PartType pt) noexcept {
+        const std::size_t b = pt > url::SCHEME ? find_end(u, pt - 1) : 0;
+        const std::size_t e = find_end(u, pt);
+        return { u.norm_url_.data() + b, e > b ? e - b : 0 };
+    }
+
+    // Returns true if concatenations of spans a[0..na) and b[0..nb) are equal
+    static bool spans_equal(const string_view* a, std::size_t na,
+        const string_view* b, std::size_t nb) noexcept {
+        std::size_t ia = 0, ib = 0; // span indices
+        std::size_t oa = 0, ob = 0; // offsets in the spans
+        for (;;) {
+            while (ia < na && oa == a[ia].length()) { ++ia; oa = 0; }
+            while (ib < nb && ob == b[ib].length()) { ++ib; ob = 0; }
+            if (ia == na || ib == nb)
+                return ia == na && ib == nb;
+            const std::size_t len = std::min(a[ia].length() - oa, b[ib].length() - ob);
+            if (std::memcmp(a[ia].data() + oa, b[ib].data() + ob, len) != 0)
+                return false;
+            oa += len;
+            ob += len;
+        }
+    }
+
+private:
+    // Trailing parts, which are not serialized, have zero end offsets
+    static std::size_t find_end(const url& u, int pt) noexcept {
+        for (; pt >= url::SCHEME; --pt) {
+            if (u.part_end_[pt])
+                return u.part_end_[pt];
+        }
+        return 0;
+    }
+};
+
+template <url::PartType... Parts>
+struct url_part_spans {
+    explicit url_part_spans(const url& u) noexcept
+        : spans{ url_parts::span(u, Parts)... }
+    {}
+
+    static constexpr std::size_t size() noexcept { return sizeof...(Parts); }
+
+    string_view spans[sizeof...(Parts)];
+};
+
+} // namespace detail
+
+
+/// @brief Hash function object for the selected URL's parts
+///
+/// Hashes the concatenation of the selected URL's parts, each taken with its
+/// leading delimiter (for example ":" of the port, "?" of the query). The
+/// parts are read from the serialized URL, so nothing is allocated.
+///
+/// Useful selections:
+/// * `url_hash<url::SCHEME, url::SCHEME_SEP, url::HOST, url::PORT>` - the
+///   serialized origin for URLs with a special scheme (except "file:")
+/// * `url_hash<url::SCHEME, url::SCHEME_SEP, url::USERNAME, url::PASSWORD,
+///   url::HOST_START, url::HOST, url::PORT, url::PATH_PREFIX, url::PATH,
+///   url::QUERY>` - the URL without a fragment
+///
+/// The string_view overload hashes the string, which must equal to the
+/// concatenation above to get the same value; it enables the heterogeneous
+/// lookup together with upa::url_equal.
+///
+/// @tparam Part, Parts URL's parts to hash, in increasing order
+template <url::PartType Part, url::PartType... Parts>
+struct url_hash {
+    using is_transparent = void;
+
+    std::size_t operator()(const url& u) const noexcept {
+        const detail::url_part_spans<Part, Parts...> parts(u);
+        util::hasher h;
+        for (const auto& span : parts.spans)
+            h.update(span.data(), span.length());
+        return static_cast<std::size_t>(h.result());
+    }
+
+    std::size_t operator()(string_view str) const noexcept {
+        return static_cast<std::size_t>(util::hash_bytes(str.data(), str.length()));
+    }
+};
+
+/// @brief Equality function object for the selected URL's parts
+///
+/// Compares the concatenations of the selected URL's parts, as described
+/// in upa::url_hash. Nothing is allocated.
+///
+/// @tparam Part, Parts URL's parts to compare, in increasing order
+template <url::PartType Part, url::PartType... Parts>
+struct url_equal {
+    using is_transparent = void;
+
+    bool operator()(const url& lhs, const url& rhs) const noexcept {
+        using spans_type = detail::url_part_spans<Part, Parts...>;
+        const spans_type lparts(lhs);
+        const spans_type rparts(rhs);
+        return detail::url_parts::spans_equal(
+            lparts.spans, spans_type::size(),
+            rparts.spans, spans_type::size());
+    }
+
+    bool operator()(const url& lhs, string_view rhs) const noexcept {
+        using spans_type = detail::url_part_spans<Part, Parts...>;
+        const spans_type lparts(lhs);
+        return detail::url_parts::spans_equal(lparts.spans, spans_type::size(), &rhs, 1);
+    }
+
+    bool operator()(string_view lhs, const url& rhs) const noexcept {
+        return operator()(rhs, lhs);
+    }
+};
+
+
+} // namespace upa
+
+#endif // UPA_URL_HASH_H
@@ -10,9 +10,11 @@
 #include "config.h"
 #include "str_arg.h"
 #include "url_idna.h"
+#include "url_instrumentation.h"
 #include "url_ip.h"
 #include "url_percent_encode.h"
 #include "url_result.h"
+#include "url_tracing.h"
 #include "url_utf.h"
 #include "util.h"
 #include <algorithm> // any_of
@@ -53,16 +55,22 @@ class host_output {
     bool need_save_ = true;
 };
 
+// The host parser reports non-failure validation errors to the reporter (the
+// `warn` parameter), if it is enabled; see detail::null_validation_reporter.
+
 class host_parser {
 public:
-    template <typename CharT>
-    static validation_errc parse_host(const CharT* first, const CharT* last, bool is_opaque, host_output& dest);
+    template <typename CharT, class Reporter = detail::null_validation_reporter>
+    static validation_errc parse_host(const CharT* first, const CharT* last, bool is_opaque, host_output& dest,
+        const Reporter& warn = Reporter{});
 
-    template <typename CharT>
-    static validation_errc parse_opaque_host(const CharT* first, const CharT* last, host_output& dest);
+    template <typename CharT, class Reporter = detail::null_validation_reporter>
+    static validation_errc parse_opaque_host(const CharT* first, const CharT* last, host_output& dest,
+        const Reporter& warn = Reporter{});
 
-    template <typename CharT>
-    static validation_errc parse_ipv4(const CharT* first, const CharT* last, host_output& dest);
+    template <typename CharT, class Reporter = detail::null_validation_reporter>
+    static validation_errc parse_ipv4(const CharT* first, const CharT* last, host_output& dest,
+        const Reporter& warn = Reporter{});
 
     template <typename CharT>
     static validation_errc parse_ipv6(const CharT* first, const CharT* last, host_output& dest);
@@ -149,15 +157,43 @@ inline bool contains_forbidden_host_char(const CharT* first, const CharT* last)
     return std::any_of(first, last, detail::is_forbidden_host_char<CharT>);
 }
 
+// Reports validation errors at the fixed input position. It is used to parse
+// strings, which are not the part of input, such as the domain to ASCII result.
+template <class Reporter, typename CharT>
+class validation_reporter_at {
+public:
+    static const bool enabled = Reporter::enabled;
+
+    validation_reporter_at(const Reporter& warn, const CharT* at) noexcept
+        : warn_(warn)
+        , at_(at)
+    {}
+
+    template <typename T>
+    void operator()(validation_errc err, const T*) const {
+        warn_(err, at_);
+    }
+
+private:
+    const Reporter& warn_; // NOLINT(cppcoreguidelines-avoid-const-or-ref-data-members)
+    const CharT* at_;
+};
+
+template <class Reporter, typename CharT>
+const bool validation_reporter_at<Reporter, CharT>::enabled;
+
 } // namespace detail
 
 
 // The host parser
 // https://url.spec.whatwg.org/#concept-host-parser
 
-template <typename CharT>
-inline validation_errc host_parser::parse_host(const CharT* first, const CharT* last, bool is_opaque, host_output& dest) {
+template <typename CharT, class Reporter>
+inline validation_errc host_parser::parse_host(const CharT* first, const CharT* last, bool is_opaque, host_output& dest,
+    const Reporter& warn)
+{
     using UCharT = typename std::make_unsigned<CharT>::type;
+    UPA_TRACE_SCOPE("host_parser::parse_host");
 
     // 1. Non-"file" special URL's cannot have an empty host.
     // 2. For "file" URL's empty host is set in the file_host_state 1.2
@@ -183,7 +219,7 @@ inline validation_errc host_parser::parse_host(const CharT* first, const CharT*
     }
 
     if (is_opaque)
-        return parse_opaque_host(first, last, dest);
+        return parse_opaque_host(first, last, dest, warn);
 
     // Is ASCII domain?
     const auto ptr = std::find_if_not(first, last, detail::is_ascii_domain_char<CharT>);
@@ -193,7 +229,7 @@ inline validation_errc host_parser::parse_host(const CharT* first, const CharT*
 
             // If asciiDomain ends in a number, return the result of IPv4 parsing asciiDomain
             if (hostname_ends_in_a_number(first, last))
-                return parse_ipv4(first, last, dest);
+                return parse_ipv4(first, last, dest, warn);
 
             if (dest.need_save()) {
                 // Return asciiDomain lower cased
@@ -262,9 +298,13 @@ inline validation_errc host_parser::parse_host(const CharT* first, const CharT*
 
 
     // domain to ASCII
+    UPA_INSTRUMENT_SLOW_PATH(host_idna);
     simple_buffer<char16_t> buff_ascii;
 
-    const auto res = domain_to_ascii(buff_uc.data(), buff_uc.size(), buff_ascii);
+    const auto res = [&]() {
+        UPA_TRACE_SCOPE("domain_to_ascii");
+        return domain_to_ascii(buff_uc.data(), buff_uc.size(), buff_ascii);
+    }();
     if (res != validation_errc::ok)
         return res;
     if (detail::contains_forbidden_domain_char(buff_ascii.data(), buff_ascii.data() + buff_ascii.size())) {
@@ -274,8 +314,11 @@ inline validation_errc host_parser::parse_host(const CharT* first, const CharT*
     }
 
     // If asciiDomain ends in a number, return the result of IPv4 parsing asciiDomain
-    if (hostname_ends_in_a_number(buff_ascii.begin(), buff_ascii.end()))
-        return parse_ipv4(buff_ascii.begin(), buff_ascii.end(), dest);
+    if (hostname_ends_in_a_number(buff_ascii.begin(), buff_ascii.end())) {
+        // the errors are reported at the host start
+        return parse_ipv4(buff_ascii.begin(), buff_ascii.end(), dest,
+            detail::validation_reporter_at<Reporter, CharT>(warn, first));
+    }
 
     if (dest.need_save()) {
         // Return asciiDomain
@@ -289,18 +332,21 @@ inline validation_errc host_parser::parse_host(const CharT* first, const CharT*
 // The opaque-host parser
 // https://url.spec.whatwg.org/#concept-opaque-host-parser
 
-template <typename CharT>
-inline validation_errc host_parser::parse_opaque_host(const CharT* first, const CharT* last, host_output& dest) {
+template <typename CharT, class Reporter>
+inline validation_errc host_parser::parse_opaque_host(const CharT* first, const CharT* last, host_output& dest,
+    const Reporter& warn)
+{
     // 1. If input contains a forbidden host code point, host-invalid-code-point
     // validation error, return failure.
     if (detail::contains_forbidden_host_char(first, last))
         return validation_errc::host_invalid_code_point;
 
-    // TODO-WARN:
     // 2. If input contains a code point that is not a URL code point and not U+0025 (%),
     // invalid-URL-unit validation error.
     // 3. If input contains a U+0025 (%) and the two code points following it are not ASCII hex digits,
     // invalid-URL-unit validation error.
+    if (warn.enabled)
+        warn.check_url_units(first, last, false);
 
     if (dest.need_save()) {
         std::string& str_host = dest.hostStart();
@@ -332,11 +378,13 @@ inline validation_errc host_parser::parse_opaque_host(const CharT* first, const
     return validation_errc::ok;
 }
 
-template <typename CharT>
-inline validation_errc host_parser::parse_ipv4(const CharT* first, const CharT* last, host_output& dest) {
+template <typename CharT, class Reporter>
+inline validation_errc host_parser::parse_ipv4(const CharT* first, const CharT* last, host_output& dest,
+    const Reporter& warn)
+{
     uint32_t ipv4;  // NOLINT(cppcoreguidelines-init-variables)
 
-    const auto res = ipv4_parse(first, last, ipv4);
+    const auto res = ipv4_parse(first, last, ipv4, warn);
     if (res == validation_errc::ok && dest.need_save()) {
         std::string& str_ipv4 = dest.hostStart();
         ipv4_serialize(ipv4, str_ipv4);
@@ -0,0 +1,139 @@
+// Copyright 2016-2024 Rimas Misevičius
+// Distributed under the BSD-style license that can be
+// found in the LICENSE file.
+//
+
+#ifndef UPA_URL_INSTRUMENTATION_H
+#define UPA_URL_INSTRUMENTATION_H
+
+// Opt-in URL parser instrumentation
+//
+// If the UPA_URL_INSTRUMENTATION macro is defined (the library and all its
+// users must be compiled with it), the URL parser counts entries into each
+// of its states and into slow paths. Counters are thread local. Otherwise the
+// instrumentation macros expand to nothing.
+
+#include <cstddef>
+#include <cstdint>
+
+#ifdef UPA_URL_INSTRUMENTATION
+
+namespace upa {
+namespace instrumentation {
+
+/// @brief Slow paths of the URL parser
+enum class slow_path : std::size_t {
+    remove_whitespace = 0, ///< ASCII tab or newline removed from the input
+    host_idna,             ///< host converted with domain_to_ascii
+    percent_encode,        ///< byte percent encoded
+    path_shorten,          ///< path shortened by a ".." segment
+    count
+};
+
+/// Number of url_parser::State values
+const std::size_t state_count = 22;
+/// Number of slow_path values
+const std::size_t slow_path_count = static_cast<std::size_t>(slow_path::count);
+
+/// @brief Instrumentation counters
+///
+/// Counters of several threads can be aggregated with operator+=.
+struct counters {
+    /// Entries into each url_parser::State
+    std::uint64_t state[state_count] = {};
+    /// Entries into each slow_path
+    std::uint64_t slow[slow_path_count] = {};
+
+    /// @brief Adds counters of another object
+    /// @param[in] other counters to add
+    /// @return reference to this object
+    counters& operator+=(const counters& other) noexcept {
+        for (std::size_t ind = 0; ind < state_count; ++ind)
+            state[ind] += other.state[ind];
+        for (std::size_t ind = 0; ind < slow_path_count; ++ind)
+            slow[ind] += other.slow[ind];
+        return *this;
+    }
+
+    /// @brief Resets all counters to zero
+    void reset() noexcept {
+        *this = counters{};
+    }
+};
+
+/// @return counters of the current thread
+inline counters& thread_counters() noexcept {
+    static thread_local counters ctrs;
+    return ctrs;
+}
+
+/// @brief Takes counters of the current thread and resets them
+///
+/// @return counters of the current thread before reset
+inline counters take_thread_counters() noexcept {
+    counters& ctrs = thread_counters();
+    const counters res = ctrs;
+    ctrs.reset();
+    return res;
+}
+
+/// @param[in] state url_parser::State value
+/// @return state name, or `nullptr` if state is out of range
+inline const char* state_name(std::size_t state) noexcept {
+    static const char* const names[state_count] = {
+        "not_set",
+        "scheme_start",
+        "scheme",
+        "no_scheme",
+        "special_relative_or_authority",
+        "path_or_authority",
+        "relative",
+        "relative_slash",
+        "special_authority_slashes",
+        "special_authority_ignore_slashes",
+        "authority",
+        "host",
+        "hostname",
+        "port",
+        "file",
+        "file_slash",
+        "file_host",
+        "path_start",
+        "path",
+        "opaque_path",
+        "query",
+        "fragment"
+    };
+    return state < state_count ? names[state] : nullptr;
+}
+
+/// @param[in] sp slow path
+/// @return slow path name, or `nullptr` if sp is out of range
+inline const char* slow_path_name(slow_path sp) noexcept {
+    static const char* const names[slow_path_count] = {
+        "remove_whitespace",
+        "host_idna",
+        "percent_encode",
+        "path_shorten"
+    };
+    const auto ind = static_cast<std::size_t>(sp);
+    return ind < slow_path_count ? names[ind] : nullptr;
+}
+
+} // namespace instrumentation
+} // namespace upa
+
+# define UPA_INSTRUMENT_STATE(st) \
+    (++::upa::instrumentation::thread_counters().state[static_cast<std::size_t>(st)])
+# define UPA_INSTRUMENT_SLOW_PATH(sp) \
+    (++::upa::instrumentation::thread_counters().slow[ \
+        static_cast<std::size_t>(::upa::instrumentation::slow_path::sp)])
+
+#else
+
+# define UPA_INSTRUMENT_STATE(st) ((void)0)
+# define UPA_INSTRUMENT_SLOW_PATH(sp) ((void)0)
+
+#endif // UPA_URL_INSTRUMENTATION
+
+#endif // UPA_URL_INSTRUMENTATION_H
@@ -52,7 +52,7 @@ inline bool hostname_ends_in_a_number(const CharT* first, const CharT* last) {
 // - if resulting number can not be represented by uint32_t value, then returns
 //   validation_errc::ipv4_non_numeric_part
 //
-// TODO-WARN: validationError
+// The IPv4-non-decimal-part validation error is reported by ipv4_parse.
 //
 template <typename CharT>
 inline validation_errc ipv4_parse_number(const CharT* first, const CharT* last, uint32_t& number) {
@@ -130,14 +130,14 @@ inline validation_errc ipv4_parse_number(const CharT* first, const CharT* last,
 //
 // - on success sets ipv4 value and returns validation_errc::ok
 // - on failure returns validation error code
+// - non-failure validation errors are reported to the warn, if it is enabled
 //
-template <typename CharT>
-inline validation_errc ipv4_parse(const CharT* first, const CharT* last, uint32_t& ipv4) {
+template <typename CharT, class Reporter = detail::null_validation_reporter>
+inline validation_errc ipv4_parse(const CharT* first, const CharT* last, uint32_t& ipv4,
+    const Reporter& warn = Reporter{})
+{
     using UCharT = typename std::make_unsigned<CharT>::type;
 
-    // 2. If the last item in parts is the empty string, then
-    //    1. IPv4-empty-part validation error. (TODO-WARN)
-    //
     // Failure comes from: 5.2 & "IPv4 number parser":
     // 1. If input is the empty string, then return failure.
     if (first == last)
@@ -167,10 +167,11 @@ inline validation_errc ipv4_parse(const CharT* first, const CharT* last, uint32_
     }
 
     // 2. If the last item in parts is the empty string, then:
-    //    1. IPv4-empty-part validation error. (TODO-WARN)
+    //    1. IPv4-empty-part validation error.
     //    2. If parts’s size is greater than 1, then remove the last item from parts.
     int part_count = dot_count + 1;
     if (dot_count > 0 && part[dot_count] == last) {
+        if (warn.enabled) warn(validation_errc::ipv4_empty_part, last - 1);
         --part_count;
     } else {
         // the part[part_count] - 1 must point to the end of last part:
@@ -186,10 +187,12 @@ inline validation_errc ipv4_parse(const CharT* first, const CharT* last, uint32_
         const auto res = ipv4_parse_number(part[ind], part[ind + 1] - 1, number[ind]);
         // 5.2. If result is failure, IPv4-non-numeric-part validation error, return failure.
         if (res != validation_errc::ok) return res;
-        // TODO-WARN: 5.3. If result[1] is true, IPv4-non-decimal-part validation error.
+        // 5.3. If result[1] is true, IPv4-non-decimal-part validation error.
+        // The result[1] is true for numbers starting with "0x", "0X" or "0" and
+        // having at least two code points.
+        if (warn.enabled && part[ind + 1] - 1 - part[ind] >= 2 && part[ind][0] == '0')
+            warn(validation_errc::ipv4_non_decimal_part, part[ind]);
     }
-    // TODO-WARN:
-    // 6. If any item in numbers is greater than 255, IPv4-out-of-range-part validation error.
 
     // 7. If any but the last item in numbers is greater than 255, then return failure.
     for (int ind = 0; ind < part_count - 1; ++ind) {
@@ -200,6 +203,10 @@ inline validation_errc ipv4_parse(const CharT* first, const CharT* last, uint32_
     ipv4 = number[part_count - 1];
     if (ipv4 > (std::numeric_limits<uint32_t>::max() >> (8 * (part_count - 1))))
         return validation_errc::ipv4_out_of_range_part;
+    // 6. If any item in numbers is greater than 255, IPv4-out-of-range-part validation error.
+    // Only the last item can be greater than 255 here; it is reported for valid addresses only.
+    if (warn.enabled && ipv4 > 255)
+        warn(validation_errc::ipv4_out_of_range_part, part[part_count - 1]);
 
     // 14.1. Increment ipv4 by n * 256**(3 - counter).
     for (int counter = 0; counter < part_count - 1; ++counter) {
@@ -0,0 +1,196 @@
+// Copyright 2016-2024 Rimas Misevičius
+// Distributed under the BSD-style license that can be
+// found in the LICENSE file.
+//
+// This file is included at the end of url.h, but it can also be
+// included on its own.
+//
+
+#ifndef UPA_URL_ORIGIN_H
+#define UPA_URL_ORIGIN_H
+
+#include "url.h"
+#include "util.h"
+#include <cstddef>
+#include <functional> // std::hash
+#include <memory>
+#include <string>
+
+namespace upa {
+
+/// @brief URL's origin
+///
+/// Represents the [origin](https://html.spec.whatwg.org/multipage/browsers.html#concept-origin)
+/// of a URL without serializing it: a tuple origin (scheme, host, port) or an
+/// opaque origin. The tuple origin refers to the scheme, host and port of
+/// the URL it was obtained from, so that URL must outlive the url_origin
+/// object and must not be modified. Only the origin of a "blob:" URL is
+/// obtained by parsing the URL's path, and then the url_origin object owns
+/// the parsed URL.
+///
+/// Opaque origins are equal only if they were obtained from the same url
+/// object (or are default constructed).
+class url_origin {
+public:
+    /// @brief Default constructor
+    ///
+    /// Constructs an opaque origin.
+    url_origin() noexcept = default;
+
+    /// @brief Constructs origin of the URL
+    ///
+    /// More info: https://url.spec.whatwg.org/#concept-url-origin
+    ///
+    /// Note: For file URLs, this implementation returns an opaque origin.
+    ///
+    /// @param[in] u URL
+    explicit url_origin(const url& u);
+
+    /// @return `true` if origin is opaque, `false` if it is a tuple origin
+    bool is_opaque() const noexcept { return scheme_inf_ == nullptr; }
+
+    /// @return the scheme of the tuple origin, or empty string if origin is opaque
+    string_view scheme() const noexcept {
+        return scheme_inf_ ? scheme_inf_->scheme : string_view{};
+    }
+
+    /// @return the serialized host of the tuple origin, or empty string if origin is opaque
+    string_view host() const noexcept { return host_; }
+
+    /// @return the port of the tuple origin, or empty string if the port is null or
+    ///   origin is opaque
+    string_view port() const noexcept { return port_; }
+
+    /// @brief Serializes the origin
+    ///
+    /// More info: https://html.spec.whatwg.org/multipage/browsers.html#ascii-serialisation-of-an-origin
+    ///
+    /// @return ASCII serialized origin, the same as url::origin() returns
+    std::string to_string() const;
+
+    /// @return hash value of the origin; for tuple origins it is equal to
+    ///   `util::hash_bytes` of the serialized origin. It is computed once,
+    ///   in the constructor.
+    std::size_t hash() const noexcept { return hash_; }
+
+    friend bool operator==(const url_origin& lhs, const url_origin& rhs) noexcept;
+
+private:
+    const url::scheme_info* scheme_inf_ = nullptr;
+    string_view host_;
+    string_view port_;
+    // identifies an opaque origin
+    const void* opaque_id_ = nullptr;
+    // the URL parsed from the "blob:" URL's path
+    std::shared_ptr<const url> blob_url_;
+    // hash value, see hash()
+    std::size_t hash_ = std::hash<const void*>{}(nullptr);
+};
+
+
+// url_origin class
+
+inline url_origin::url_origin(const url& u) {
+    const url* src = &u;
+    if (!u.is_special_scheme() && u.get_part_view(url::SCHEME) == string_view{ "blob", 4 }) {
+        // Note: this library does not support blob URL store, so it allways assumes
+        // URL's blob URL entry is null and retrieves origin from the URL's path.
+        std::shared_ptr<url> path_url = std::make_shared<url>();
+        if (path_url->parse(u.get_part_view(url::PATH)) == validation_errc::ok &&
+            path_url->is_http_scheme()) {
+            blob_url_ = std::move(path_url);
+            src = blob_url_.get();
+        }
+    }
+    if (src->is_special_scheme() && !src->is_file_scheme()) {
+        scheme_inf_ = src->scheme_inf_;
+        host_ = src->get_part_view(url::HOST);
+        port_ = src->get_part_view(url::PORT);
+
+        util::hasher h;
+        h.update(scheme_inf_->scheme.data(), scheme_inf_->scheme.length());
+        h.update("://", 3);
+        h.update(host_.data(), host_.length());
+        if (!port_.empty()) {
+            h.update(":", 1);
+            h.update(port_.data(), port_.length());
+        }
+        hash_ = static_cast<std::size_t>(h.result());
+    } else {
+        opaque_id_ = &u;
+        hash_ = std::hash<const void*>{}(opaque_id_);
+    }
+}
+
+inline std::string url_origin::to_string() const {
+    if (is_opaque())
+        return "null";
+    std::string str_origin;
+    str_origin.reserve(scheme_inf_->scheme.length() + host_.length() + port_.length() + 4);
+    util::append(str_origin, scheme_inf_->scheme);
+    str_origin.append("://");
+    util::append(str_origin, host_);
+    if (!port_.empty()) {
+        str_origin.push_back(':');
+        util::append(str_origin, port_);
+    }
+    return str_origin;
+}
+
+/// @brief Compares two origins
+///
+/// Tuple origins are equal if their schemes, hosts and ports are equal.
+///
+/// @param[in] lhs, rhs origins to compare
+/// @return `true` if origins are the same
+inline bool operator==(const url_origin& lhs, const url_origin& rhs) noexcept {
+    // different hashes reject most of the unequal origins;
+    // scheme_inf_ points to the static url::kSchemes array item
+    return lhs.hash_ == rhs.hash_ &&
+        lhs.scheme_inf_ == rhs.scheme_inf_ &&
+        (lhs.scheme_inf_
+            ? lhs.port_ == rhs.port_ && lhs.host_ == rhs.host_
+            : lhs.opaque_id_ == rhs.opaque_id_);
+}
+
+/// @brief Compares two origins
+///
+/// @param[in] lhs, rhs origins to compare
+/// @return `true` if origins are not the same
+inline bool operator!=(const url_origin& lhs, const url_origin& rhs) noexcept {
+    return !(lhs == rhs);
+}
+
+/// @brief Checks whether the origins of two URLs are the same
+///
+/// More info: https://html.spec.whatwg.org/multipage/browsers.html#same-origin
+///
+/// Opaque origins are the same only if @a lhs and @a rhs refer to the
+/// same url object.
+///
+/// It does not allocate memory, except for "blob:" URLs: the origin of each
+/// of them is obtained by parsing the URL's path into a new url object.
+///
+/// @param[in] lhs, rhs URLs to compare
+/// @return `true` if URLs have the same origin
+inline bool same_origin(const url& lhs, const url& rhs) {
+    return url_origin(lhs) == url_origin(rhs);
+}
+
+
+} // namespace upa
+
+
+namespace std {
+
+/// @brief std::hash specialization for upa::url_origin class
+template<>
+struct hash<upa::url_origin> {
+    std::size_t operator()(const upa::url_origin& origin) const noexcept {
+        return origin.hash();
+    }
+};
+
+} // namespace std
+
+#endif // UPA_URL_ORIGIN_H
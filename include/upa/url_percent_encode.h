@@ -12,6 +12,7 @@
 
 #include "config.h"
 #include "str_arg.h"
+#include "url_instrumentation.h"
 #include "url_utf.h"
 #include "util.h"
 #include <cstddef>
@@ -447,6 +448,7 @@ inline bool decode_hex_to_byte(const CharT*& first, const CharT* last, unsigned
 // See: https://url.spec.whatwg.org/#percent-encode
 
 inline void append_percent_encoded_byte(unsigned char uc, std::string& output) {
+    UPA_INSTRUMENT_SLOW_PATH(percent_encode);
     output.push_back('%');
     output.push_back(kHexCharLookup[uc >> 4]);
     output.push_back(kHexCharLookup[uc & 0xf]);
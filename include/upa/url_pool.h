@@ -0,0 +1,299 @@
+// Copyright 2016-2024 Rimas Misevičius
+// Distributed under the BSD-style license that can be
+// found in the LICENSE file.
+//
+
+#ifndef UPA_URL_POOL_H
+#define UPA_URL_POOL_H
+
+#include "url.h"
+#include "url_record.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace upa {
+
+/// @brief Deduplicating pool of parsed URLs
+///
+/// Stores each distinct URL once, as the serialized URL followed by the
+/// compactly encoded part offsets and flags, in large arena blocks. The
+/// stored URL is identified by a 32-bit handle, which can be used to get
+/// the serialized URL or its parts without reparsing, or to reconstruct
+/// the upa::url object.
+///
+/// URLs are interned by the hash of the serialized URL, so two URLs get the
+/// same handle if their `href()` values are equal.
+///
+/// The stored data is never moved, so string views returned by the pool
+/// remain valid until the pool is cleared or destroyed.
+class url_pool {
+public:
+    /// URL handle type
+    using handle = std::uint32_t;
+
+    /// @brief Default constructor
+    url_pool() = default;
+
+    url_pool(const url_pool&) = delete;
+    url_pool& operator=(const url_pool&) = delete;
+
+    /// @brief Move constructor
+    url_pool(url_pool&&) noexcept = default;
+
+    /// @brief Move assignment
+    url_pool& operator=(url_pool&&) noexcept = default;
+
+    /// @brief Interns URL
+    ///
+    /// Throws std::length_error if the pool already contains the max number
+    /// of URLs.
+    ///
+    /// @param[in] u URL to intern
+    /// @return pair of the URL's handle and the `bool` value set to `true`
+    ///   if the URL was added, or `false` if it was already in the pool
+    std::pair<handle, bool> insert(const url& u);
+
+    /// @brief Finds URL in the pool
+    /// @param[in]  u URL to find
+    /// @param[out] h handle of the found URL
+    /// @return `true` if URL is found
+    bool find(const url& u, handle& h) const noexcept;
+
+    /// @brief Finds URL in the pool by its serialized form
+    /// @param[in]  href serialized URL (the `url::href()` value) to find
+    /// @param[out] h    handle of the found URL
+    /// @return `true` if URL is found
+    bool find(string_view href, handle& h) const noexcept;
+
+    /// @return number of URLs in the pool
+    std::size_t size() const noexcept { return records_.size(); }
+
+    /// @return `true` if pool has no URLs
+    bool empty() const noexcept { return records_.empty(); }
+
+    /// @return number of bytes allocated for URL data in the arena blocks
+    std::size_t arena_size() const noexcept { return arena_size_; }
+
+    /// @brief Removes all URLs from the pool
+    ///
+    /// Invalidates all handles and string views returned by the pool.
+    void clear() noexcept;
+
+    /// @brief Reserves space for the URL handles
+    /// @param[in] count number of URLs to reserve space for
+    void reserve(std::size_t count);
+
+    /// @brief Gets serialized URL
+    /// @param[in] h URL handle
+    /// @return serialized URL, the same as `url::href()` returns
+    string_view href(handle h) const noexcept;
+
+    /// @brief Gets URL's part
+    /// @param[in] h URL handle
+    /// @param[in] t URL's part
+    /// @return URL's part, the same as `url::get_part_view(t)` returns
+    string_view get_part_view(handle h, url::PartType t) const noexcept;
+
+    /// @brief Checks whether URL's part is null
+    /// @param[in] h URL handle
+    /// @param[in] t URL's part
+    /// @return `true` if URL's part is null
+    bool is_null(handle h, url::PartType t) const noexcept;
+
+    /// @brief Reconstructs URL without reparsing
+    /// @param[in]  h   URL handle
+    /// @param[out] out reconstructed URL
+    void get_url(handle h, url& out) const;
+
+    /// @brief Reconstructs URL without reparsing
+    /// @param[in] h URL handle
+    /// @return reconstructed URL
+    url get_url(handle h) const;
+
+private:
+    enum : std::size_t {
+        kBlockSize = 1 << 20,
+        kMinTableSize = 16
+    };
+
+    detail::url_record_view get_record(handle h) const noexcept;
+
+    char* allocate(std::size_t len);
+
+    template <class Eq>
+    std::size_t find_slot(std::uint64_t hash, Eq&& eq) const noexcept;
+
+    void grow_table();
+
+private:
+    // arena blocks
+    std::vector<std::unique_ptr<char[]>> blocks_;
+    char* block_ptr_ = nullptr;
+    std::size_t block_left_ = 0;
+    std::size_t arena_size_ = 0;
+
+    // record start for each handle
+    std::vector<const char*> records_;
+    // lower 32 bits of the serialized URL's hash for each handle
+    std::vector<std::uint32_t> hashes_;
+    // open addressing hash table of (handle + 1); 0 marks an empty slot
+    std::vector<handle> table_;
+};
+
+
+// url_pool class
+
+inline std::pair<url_pool::handle, bool> url_pool::insert(const url& u) {
+    const std::uint64_t hash = detail::url_record::hash(u);
+    if (!table_.empty()) {
+        const string_view str = u.href();
+        const std::size_t slot = find_slot(hash, [&](handle h) {
+            return href(h) == str;
+        });
+        if (table_[slot])
+            return { table_[slot] - 1, false };
+    }
+
+    if (records_.size() >= static_cast<handle>(-1) - 1)
+        throw std::length_error("too many URLs in the url_pool");
+    if ((records_.size() + 1) * 2 > table_.size())
+        grow_table();
+
+    // encode record
+    const string_view str = u.href();
+    char head[detail::url_record::kMaxVarintSize];
+    char tail[detail::url_record::kMaxOverhead];
+    const std::size_t head_len = detail::url_record::encode_head(u, head);
+    const std::size_t tail_len = detail::url_record::encode_tail(u, tail);
+    char* rec = allocate(head_len + str.length() + tail_len);
+    std::memcpy(rec, head, head_len);
+    std::memcpy(rec + head_len, str.data(), str.length());
+    std::memcpy(rec + head_len + str.length(), tail, tail_len);
+
+    const auto h = static_cast<handle>(records_.size());
+    records_.push_back(rec);
+    hashes_.push_back(static_cast<std::uint32_t>(hash));
+    const std::size_t slot = find_slot(hash, [](handle) { return false; });
+    table_[slot] = h + 1;
+    return { h, true };
+}
+
+inline bool url_pool::find(const url& u, handle& h) const noexcept {
+    return find(u.href(), h);
+}
+
+inline bool url_pool::find(string_view str, handle& h) const noexcept {
+    if (table_.empty())
+        return false;
+    const std::size_t slot = find_slot(util::hash_bytes(str.data(), str.length()), [&](handle hc) {
+        return href(hc) == str;
+    });
+    if (!table_[slot])
+        return false;
+    h = table_[slot] - 1;
+    return true;
+}
+
+inline void url_pool::clear() noexcept {
+    blocks_.clear();
+    block_ptr_ = nullptr;
+    block_left_ = 0;
+    arena_size_ = 0;
+    records_.clear();
+    hashes_.clear();
+    table_.clear();
+}
+
+inline void url_pool::reserve(std::size_t count) {
+    records_.reserve(count);
+    hashes_.reserve(count);
+}
+
+inline string_view url_pool::href(handle h) const noexcept {
+    const char* first = records_[h];
+    std::uint64_t len;
+    detail::url_record::decode_varint(first, first + detail::url_record::kMaxVarintSize, len);
+    return { first, static_cast<std::size_t>(len) };
+}
+
+inline string_view url_pool::get_part_view(handle h, url::PartType t) const noexcept {
+    return get_record(h).get_part_view(t);
+}
+
+inline bool url_pool::is_null(handle h, url::PartType t) const noexcept {
+    return get_record(h).is_null(t);
+}
+
+inline void url_pool::get_url(handle h, url& out) const {
+    detail::url_record::assign(out, get_record(h));
+}
+
+inline url url_pool::get_url(handle h) const {
+    url u;
+    get_url(h, u);
+    return u;
+}
+
+inline detail::url_record_view url_pool::get_record(handle h) const noexcept {
+    // the record was encoded by insert(), so it is not bounded here
+    const char* first = records_[h];
+    const char* last = first + href(h).length() + detail::url_record::kMaxVarintSize +
+        detail::url_record::kMaxOverhead;
+    detail::url_record_view rec;
+    detail::url_record::decode(first, last, rec);
+    return rec;
+}
+
+inline char* url_pool::allocate(std::size_t len) {
+    if (len > block_left_) {
+        // a long record gets its own block, so the rest of the current
+        // block can still be used
+        if (len > kBlockSize / 4) {
+            blocks_.emplace_back(new char[len]);
+            arena_size_ += len;
+            return blocks_.back().get();
+        }
+        blocks_.emplace_back(new char[kBlockSize]);
+        arena_size_ += kBlockSize;
+        block_ptr_ = blocks_.back().get();
+        block_left_ = kBlockSize;
+    }
+    char* ptr = block_ptr_;
+    block_ptr_ += len;
+    block_left_ -= len;
+    return ptr;
+}
+
+template <class Eq>
+inline std::size_t url_pool::find_slot(std::uint64_t hash, Eq&& eq) const noexcept {
+    // linear probing; the table size is a power of two
+    const std::size_t mask = table_.size() - 1;
+    const auto hash32 = static_cast<std::uint32_t>(hash);
+    for (std::size_t slot = hash32 & mask;; slot = (slot + 1) & mask) {
+        const handle hs = table_[slot];
+        if (!hs || (hashes_[hs - 1] == hash32 && eq(hs - 1)))
+            return slot;
+    }
+}
+
+inline void url_pool::grow_table() {
+    std::vector<handle> table(table_.empty() ? std::size_t(kMinTableSize) : table_.size() * 2, 0);
+    const std::size_t mask = table.size() - 1;
+    for (handle h = 0; h < records_.size(); ++h) {
+        std::size_t slot = hashes_[h] & mask;
+        while (table[slot])
+            slot = (slot + 1) & mask;
+        table[slot] = h + 1;
+    }
+    table_.swap(table);
+}
+
+
+} // namespace upa
+
+#endif // UPA_URL_POOL_H
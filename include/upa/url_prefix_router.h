@@ -0,0 +1,323 @@
+// Copyright 2016-2024 Rimas Misevičius
+// Distributed under the BSD-style license that can be
+// found in the LICENSE file.
+//
+
+#ifndef UPA_URL_PREFIX_ROUTER_H
+#define UPA_URL_PREFIX_ROUTER_H
+
+#include "url.h"
+#include "util.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace upa {
+
+/// @brief Routes URLs by the longest matching (host, path prefix) rule
+///
+/// The router is immutable: it is created by url_prefix_router::builder,
+/// and its lookups do not allocate memory or take locks, so any number of
+/// threads can use it concurrently. To reload rules without locks, build a
+/// new router and publish it through a `std::atomic<const url_prefix_router<T>*>`
+/// (store with `memory_order_release`, load with `memory_order_acquire`);
+/// readers keep using the router they have loaded until they load the new
+/// one. The replaced router can be deleted only after all readers are done
+/// with it, which must be ensured by a reclamation scheme, such as epoch
+/// based reclamation or RCU (read-copy-update).
+///
+/// Rules are matched host first, then by whole path segments: the rule's
+/// path prefix "/api/v1" matches the paths "/api/v1" and "/api/v1/users",
+/// but not "/api/v10". The lookup time is proportional to the URL's host
+/// and path length.
+///
+/// Hosts and path prefixes are compared with URL's serialized host and
+/// path, so they must be given in the serialized form (lowercase,
+/// punycode encoded domains, percent encoded paths).
+///
+/// @tparam T type of the value associated with a rule
+template <class T>
+class url_prefix_router {
+public:
+    class builder;
+
+    /// @brief Default constructor
+    ///
+    /// Constructs router without rules.
+    url_prefix_router() = default;
+
+    /// @brief Finds the value of the longest matching rule
+    ///
+    /// Rules of the URL's host take precedence over the rules added with
+    /// builder::add_any_host. URLs with an opaque path match only rules with
+    /// an empty path prefix.
+    ///
+    /// @param[in] u URL to route
+    /// @return pointer to the value, or `nullptr` if no rule matches
+    const T* find(const url& u) const noexcept;
+
+    /// @return number of rules
+    std::size_t size() const noexcept { return values_.size(); }
+
+    /// @return `true` if router has no rules
+    bool empty() const noexcept { return values_.empty(); }
+
+private:
+    static const std::uint32_t npos = static_cast<std::uint32_t>(-1);
+
+    // path trie node; children are sorted by segment
+    struct node {
+        std::uint32_t first_child;
+        std::uint32_t child_count;
+        std::uint32_t value; // index in values_, or npos
+    };
+    struct edge {
+        std::uint32_t seg_offset;
+        std::uint32_t seg_len;
+        std::uint32_t node;
+    };
+    // host hash table slot
+    struct host_slot {
+        std::uint32_t host_offset;
+        std::uint32_t host_len;
+        std::uint32_t root; // npos marks an empty slot
+    };
+
+    string_view get_string(std::uint32_t offset, std::uint32_t len) const noexcept {
+        return { strings_.data() + offset, len };
+    }
+
+    std::uint32_t find_host(string_view host) const noexcept;
+    std::uint32_t find_child(const node& nd, string_view seg) const noexcept;
+    const T* match(std::uint32_t root, const url& u) const noexcept;
+
+private:
+    std::string strings_;
+    std::vector<node> nodes_;
+    std::vector<edge> edges_;
+    std::vector<T> values_;
+    std::vector<host_slot> hosts_;
+    std::uint32_t any_host_root_ = npos;
+};
+
+/// @brief Builds url_prefix_router
+///
+/// @tparam T type of the value associated with a rule
+template <class T>
+class url_prefix_router<T>::builder {
+public:
+    /// @brief Adds rule
+    ///
+    /// The rule replaces a previously added rule with the same host and path
+    /// prefix. The trailing slash of the path prefix is ignored, so "/api/"
+    /// is the same as "/api", and "/" is the same as "".
+    ///
+    /// @param[in] host        serialized host
+    /// @param[in] path_prefix serialized path prefix
+    /// @param[in] value       value to associate with the rule
+    /// @return reference to this object
+    builder& add(string_view host, string_view path_prefix, T value) {
+        add_rule(hosts_[std::string(host.data(), host.length())], path_prefix, std::move(value));
+        return *this;
+    }
+
+    /// @brief Adds rule that matches any host
+    ///
+    /// @param[in] path_prefix serialized path prefix
+    /// @param[in] value       value to associate with the rule
+    /// @return reference to this object
+    builder& add_any_host(string_view path_prefix, T value) {
+        add_rule(any_host_, path_prefix, std::move(value));
+        return *this;
+    }
+
+    /// @brief Builds router from the added rules
+    ///
+    /// Throws std::length_error if there are too many rules.
+    ///
+    /// @return the router
+    url_prefix_router build() const;
+
+private:
+    struct build_node {
+        std::map<std::string, build_node> children;
+        std::size_t value = npos; // index in values_
+    };
+
+    void add_rule(build_node& root, string_view path_prefix, T&& value);
+    static std::uint32_t to_uint32(std::size_t value);
+    static std::uint32_t flatten(const build_node& root, url_prefix_router& router);
+
+private:
+    std::map<std::string, build_node> hosts_;
+    build_node any_host_;
+    std::vector<T> values_;
+};
+
+
+// url_prefix_router class
+
+template <class T>
+const std::uint32_t url_prefix_router<T>::npos;
+
+template <class T>
+inline const T* url_prefix_router<T>::find(const url& u) const noexcept {
+    const T* res = nullptr;
+    if (!u.is_null(url::HOST)) {
+        const std::uint32_t root = find_host(u.get_part_view(url::HOST));
+        if (root != npos)
+            res = match(root, u);
+    }
+    if (!res && any_host_root_ != npos)
+        res = match(any_host_root_, u);
+    return res;
+}
+
+template <class T>
+inline std::uint32_t url_prefix_router<T>::find_host(string_view host) const noexcept {
+    if (hosts_.empty())
+        return npos;
+    // linear probing; the table size is a power of two
+    const std::size_t mask = hosts_.size() - 1;
+    for (std::size_t ind = static_cast<std::size_t>(util::hash_bytes(host.data(), host.length())) & mask;;
+        ind = (ind + 1) & mask) {
+        const host_slot& slot = hosts_[ind];
+        if (slot.root == npos || get_string(slot.host_offset, slot.host_len) == host)
+            return slot.root;
+    }
+}
+
+template <class T>
+inline std::uint32_t url_prefix_router<T>::find_child(const node& nd, string_view seg) const noexcept {
+    const edge* first = edges_.data() + nd.first_child;
+    const edge* last = first + nd.child_count;
+    const edge* it = std::lower_bound(first, last, seg, [this](const edge& e, string_view s) {
+        return get_string(e.seg_offset, e.seg_len).compare(s) < 0;
+    });
+    if (it != last && get_string(it->seg_offset, it->seg_len) == seg)
+        return it->node;
+    return npos;
+}
+
+template <class T>
+inline const T* url_prefix_router<T>::match(std::uint32_t ind, const url& u) const noexcept {
+    const node* nd = &nodes_[ind];
+    std::uint32_t value = nd->value;
+    if (!u.has_opaque_path()) {
+        // the path is a list of segments, each prefixed with '/'
+        const string_view path = u.get_part_view(url::PATH);
+        const char* last = path.data() + path.length();
+        const char* first = path.data() + (path.empty() ? 0 : 1);
+        for (std::size_t seg_ind = 0; seg_ind < u.path_segment_count_ && nd->child_count; ++seg_ind) {
+            const char* seg_end = std::find(first, last, '/');
+            const std::uint32_t child = find_child(*nd, string_view(first, static_cast<std::size_t>(seg_end - first)));
+            if (child == npos)
+                break;
+            nd = &nodes_[child];
+            if (nd->value != npos)
+                value = nd->value;
+            if (seg_end == last)
+                break;
+            first = seg_end + 1;
+        }
+    }
+    return value != npos ? &values_[value] : nullptr;
+}
+
+
+// url_prefix_router::builder class
+
+template <class T>
+inline void url_prefix_router<T>::builder::add_rule(build_node& root, string_view path_prefix, T&& value) {
+    // drop the leading and trailing slashes
+    const char* first = path_prefix.data();
+    const char* last = first + path_prefix.length();
+    if (first != last && *first == '/')
+        ++first;
+    if (first != last && last[-1] == '/')
+        --last;
+
+    build_node* nd = &root;
+    if (first != last) {
+        for (;;) {
+            const char* seg_end = std::find(first, last, '/');
+            nd = &nd->children[std::string(first, seg_end)];
+            if (seg_end == last)
+                break;
+            first = seg_end + 1;
+        }
+    }
+    if (nd->value != npos) {
+        values_[nd->value] = std::move(value);
+    } else {
+        nd->value = values_.size();
+        values_.push_back(std::move(value));
+    }
+}
+
+template <class T>
+inline std::uint32_t url_prefix_router<T>::builder::to_uint32(std::size_t value) {
+    if (value >= npos)
+        throw std::length_error("too many url_prefix_router rules");
+    return static_cast<std::uint32_t>(value);
+}
+
+// Appends the trie to the router; children of each node get adjacent edges
+template <class T>
+inline std::uint32_t url_prefix_router<T>::builder::flatten(const build_node& root, url_prefix_router& router) {
+    const std::uint32_t root_ind = to_uint32(router.nodes_.size());
+    std::vector<const build_node*> queue{ &root };
+    router.nodes_.push_back(node{ 0, 0, npos });
+    for (std::size_t qi = 0; qi < queue.size(); ++qi) {
+        const build_node& bn = *queue[qi];
+        node& nd = router.nodes_[root_ind + qi];
+        nd.value = static_cast<std::uint32_t>(bn.value);
+        nd.first_child = to_uint32(router.edges_.size());
+        nd.child_count = to_uint32(bn.children.size());
+        for (const auto& child : bn.children) {
+            const std::uint32_t child_ind = to_uint32(router.nodes_.size());
+            router.edges_.push_back(edge{
+                to_uint32(router.strings_.length()), to_uint32(child.first.length()), child_ind });
+            router.strings_.append(child.first);
+            router.nodes_.push_back(node{ 0, 0, npos });
+            queue.push_back(&child.second);
+        }
+    }
+    return root_ind;
+}
+
+template <class T>
+inline url_prefix_router<T> url_prefix_router<T>::builder::build() const {
+    url_prefix_router router;
+    router.values_ = values_;
+    to_uint32(values_.size());
+    if (!hosts_.empty()) {
+        std::size_t table_size = 16;
+        while (table_size < hosts_.size() * 2)
+            table_size *= 2;
+        router.hosts_.assign(table_size, host_slot{ 0, 0, npos });
+        const std::size_t mask = table_size - 1;
+        for (const auto& host : hosts_) {
+            const std::uint32_t root = flatten(host.second, router);
+            std::size_t ind = static_cast<std::size_t>(util::hash_bytes(host.first.data(), host.first.length())) & mask;
+            while (router.hosts_[ind].root != npos)
+                ind = (ind + 1) & mask;
+            router.hosts_[ind] = host_slot{
+                to_uint32(router.strings_.length()), to_uint32(host.first.length()), root };
+            router.strings_.append(host.first);
+        }
+    }
+    if (!any_host_.children.empty() || any_host_.value != npos)
+        router.any_host_root_ = flatten(any_host_, router);
+    return router;
+}
+
+
+} // namespace upa
+
+#endif // UPA_URL_PREFIX_ROUTER_H
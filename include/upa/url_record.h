@@ -0,0 +1,372 @@
+// Copyright 2016-2024 Rimas Misevičius
+// Distributed under the BSD-style license that can be
+// found in the LICENSE file.
+//
+
+#ifndef UPA_URL_RECORD_H
+#define UPA_URL_RECORD_H
+
+#include "url.h"
+#include "util.h"
+#include <algorithm>
+#include <iterator> // std::begin, std::end
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace upa {
+namespace detail {
+
+// Compact encoding of the parsed URL record
+//
+// The record consists of:
+//   varint  length of the serialized URL
+//   bytes   serialized URL (url::norm_url_)
+//   varint  record flags, see url_record::encode_flags
+//   varint  url::path_segment_count_
+//   varint  url::part_end_ codes, one per part: 0 if the part is a trailing
+//           not serialized part, or (part end - previous part end + 1)
+//
+// All varints are unsigned LEB128.
+
+struct url_record_view {
+    string_view norm_url;
+    std::size_t part_end[url::PART_COUNT];
+    unsigned flags;
+    std::size_t path_segment_count;
+
+    // The same as url::get_part_view
+    string_view get_part_view(url::PartType t) const noexcept {
+        if (t == url::SCHEME)
+            return { norm_url.data(), part_end[url::SCHEME] };
+        // begin & end offsets
+        const std::size_t b = part_end[t - 1] + kPartStart[t];
+        const std::size_t e = part_end[t];
+        return { norm_url.data() + b, e > b ? e - b : 0 };
+    }
+
+    // The same as url::is_null
+    bool is_null(url::PartType t) const noexcept {
+        return !(flags & (1u << t));
+    }
+};
+
+struct url_record {
+    enum : std::size_t {
+        kMaxVarintSize = 10,
+        // max size of the encoded record without the serialized URL bytes
+        kMaxOverhead = (3 + url::PART_COUNT) * kMaxVarintSize,
+        // record flags: one bit per flag of the flag_map(), followed by
+        // three bits of the HostType value
+        kFlagCount = 10,
+        // write_url_record header: magic byte and version
+        kMagic = 0x55, // 'U'
+        kVersion = 1
+    };
+
+    // The url::UrlFlag of each record flag bit. The record flags do not depend
+    // on the url::UrlFlag values, which may change.
+    static const unsigned* flag_map() noexcept {
+        static const unsigned map[kFlagCount] = {
+            url::SCHEME_FLAG, url::USERNAME_FLAG, url::PASSWORD_FLAG,
+            url::HOST_FLAG, url::PORT_FLAG, url::PATH_FLAG, url::QUERY_FLAG,
+            url::FRAGMENT_FLAG, url::OPAQUE_PATH_FLAG, url::VALID_FLAG
+        };
+        return map;
+    }
+
+    // Converts url::flags_ to the record flags
+    static unsigned encode_flags(unsigned flags) noexcept {
+        const unsigned* map = flag_map();
+        unsigned rec_flags = 0;
+        for (unsigned bit = 0; bit < kFlagCount; ++bit) {
+            if (flags & map[bit])
+                rec_flags |= 1u << bit;
+        }
+        return rec_flags | ((flags & url::HOST_TYPE_MASK) >> url::HOST_TYPE_SHIFT) << kFlagCount;
+    }
+
+    // Converts the record flags to url::flags_; returns false on unknown
+    // flags or host type
+    static bool decode_flags(std::uint64_t rec_flags, unsigned& flags) noexcept {
+        const std::uint64_t host_type = rec_flags >> kFlagCount;
+        if (host_type > static_cast<unsigned>(HostType::IPv6))
+            return false;
+        const unsigned* map = flag_map();
+        flags = static_cast<unsigned>(host_type) << url::HOST_TYPE_SHIFT;
+        for (unsigned bit = 0; bit < kFlagCount; ++bit) {
+            if (rec_flags & (1u << bit))
+                flags |= map[bit];
+        }
+        return true;
+    }
+
+    // The special schemes in the order of their ids; the url::kSchemes order
+    // is not a part of the record format
+    static const char* const* scheme_names() noexcept {
+        static const char* const names[url::kSchemeCount] = {
+            "ftp", "file", "http", "https", "ws", "wss"
+        };
+        return names;
+    }
+
+    // FNV-1a hash of bytes in [first, last); unlike util::hash_bytes it does
+    // not depend on the byte order of the platform
+    static std::uint32_t checksum(const char* first, const char* last) noexcept {
+        std::uint32_t h = 0x811C9DC5u;
+        for (; first != last; ++first) {
+            h ^= static_cast<unsigned char>(*first);
+            h *= 0x01000193u;
+        }
+        return h;
+    }
+
+    // Writes varint to out, which must have at least kMaxVarintSize bytes;
+    // returns the number of bytes written
+    static std::size_t encode_varint(std::uint64_t value, char* out) noexcept {
+        char* p = out;
+        for (; value >= 0x80; value >>= 7)
+            *p++ = static_cast<char>((value & 0x7F) | 0x80);
+        *p++ = static_cast<char>(value);
+        return static_cast<std::size_t>(p - out);
+    }
+
+    // Reads varint from [first, last) and advances first; returns false on
+    // truncated or too long input
+    static bool decode_varint(const char*& first, const char* last, std::uint64_t& value) noexcept {
+        value = 0;
+        for (unsigned shift = 0; first != last && shift < 64; shift += 7) {
+            const auto byte = static_cast<unsigned char>(*first++);
+            value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+            if (byte < 0x80)
+                return true;
+        }
+        return false;
+    }
+
+    // Writes the record's header (the length of the serialized URL) to out
+    static std::size_t encode_head(const url& u, char* out) noexcept {
+        return encode_varint(u.norm_url_.length(), out);
+    }
+
+    // Writes the record's tail (the fields following the serialized URL) to
+    // out, which must have at least kMaxOverhead bytes
+    static std::size_t encode_tail(const url& u, char* out) noexcept {
+        std::size_t len = 0;
+        len += encode_varint(encode_flags(u.flags_), out + len);
+        len += encode_varint(u.path_segment_count_, out + len);
+        std::size_t prev_end = 0;
+        for (const std::size_t end : u.part_end_) {
+            // the url::part_end_ is zero only for trailing parts
+            len += encode_varint(end ? end - prev_end + 1 : 0, out + len);
+            if (end) prev_end = end;
+        }
+        return len;
+    }
+
+    // Decodes record from [first, last) and advances first past it. Checks
+    // that offsets are consistent with the serialized URL's length, but does
+    // not check the serialized URL itself.
+    static bool decode(const char*& first, const char* last, url_record_view& rec) noexcept {
+        std::uint64_t value;
+        if (!decode_varint(first, last, value) || value > static_cast<std::uint64_t>(last - first))
+            return false;
+        rec.norm_url = string_view(first, static_cast<std::size_t>(value));
+        first += rec.norm_url.length();
+        return decode_tail(first, last, rec);
+    }
+
+    // Decodes the record's tail from [first, last) and advances first past
+    // it; the rec.norm_url must be set
+    static bool decode_tail(const char*& first, const char* last, url_record_view& rec) noexcept {
+        std::uint64_t value;
+        if (!decode_varint(first, last, value) || !decode_flags(value, rec.flags))
+            return false;
+        if (!decode_varint(first, last, value) || value > rec.norm_url.length())
+            return false;
+        rec.path_segment_count = static_cast<std::size_t>(value);
+
+        std::size_t prev_end = 0;
+        bool trailing = false;
+        for (std::size_t& end : rec.part_end) {
+            if (!decode_varint(first, last, value))
+                return false;
+            if (value == 0) {
+                end = 0;
+                trailing = true;
+                continue;
+            }
+            // a serialized part can not follow not serialized one
+            if (trailing || value - 1 > rec.norm_url.length() - prev_end)
+                return false;
+            end = prev_end + static_cast<std::size_t>(value - 1);
+            prev_end = end;
+        }
+        // the last part must end at the end of serialized URL
+        return prev_end == rec.norm_url.length();
+    }
+
+    // Assigns decoded record to the URL without reparsing
+    static void assign(url& u, const url_record_view& rec) {
+        assign(u, rec, rec.part_end[url::SCHEME]
+            ? url::get_scheme_info(rec.get_part_view(url::SCHEME))
+            : nullptr);
+    }
+
+    // Assigns decoded record to the URL, whose scheme info is known
+    static void assign(url& u, const url_record_view& rec, const url::scheme_info* scheme_inf) {
+        u.clear();
+        u.norm_url_.assign(rec.norm_url.data(), rec.norm_url.length());
+        std::copy(std::begin(rec.part_end), std::end(rec.part_end), u.part_end_.begin());
+        u.flags_ = rec.flags;
+        u.path_segment_count_ = rec.path_segment_count;
+        u.scheme_inf_ = scheme_inf;
+        if (u.is_valid())
+            u.set_parsed();
+    }
+
+    // Hash of the serialized URL
+    static std::uint64_t hash(const url& u) noexcept {
+        return u.hash_value();
+    }
+
+    // Scheme id: 0 for not special scheme, otherwise scheme_names() index + 1
+    static unsigned scheme_id(const url& u) noexcept {
+        if (u.scheme_inf_) {
+            const char* const* names = scheme_names();
+            for (unsigned ind = 0; ind < url::kSchemeCount; ++ind) {
+                if (u.scheme_inf_->scheme == string_view(names[ind]))
+                    return ind + 1;
+            }
+        }
+        return 0;
+    }
+
+    // Checks the decoded record's scheme id, and returns its scheme info
+    static bool check(const url_record_view& rec, unsigned id, const url::scheme_info*& scheme_inf) {
+        if (id > url::kSchemeCount)
+            return false;
+        const string_view scheme = rec.get_part_view(url::SCHEME);
+        scheme_inf = url::get_scheme_info(scheme);
+        return id
+            ? scheme_inf != nullptr && scheme == string_view(scheme_names()[id - 1])
+            : scheme_inf == nullptr;
+    }
+
+    // Appends binary encoded record, see upa::write_url_record
+    static void write(const url& u, std::string& out) {
+        const string_view href = u.href();
+        char buff[kMaxOverhead];
+        const std::size_t start = out.length();
+
+        out.push_back(static_cast<char>(kMagic));
+        out.push_back(static_cast<char>(kVersion));
+        out.append(buff, encode_head(u, buff));
+        util::append(out, href);
+        out.append(buff, encode_tail(u, buff));
+        out.push_back(static_cast<char>(scheme_id(u)));
+
+        const std::uint32_t sum = checksum(out.data() + start, out.data() + out.length());
+        for (int i = 0; i < 4; ++i)
+            out.push_back(static_cast<char>((sum >> (8 * i)) & 0xFF));
+    }
+
+    // Reads binary encoded record, see upa::read_url_record
+    static bool read(const char*& first, const char* last, url& u) {
+        if (last - first < 2 ||
+            static_cast<unsigned char>(first[0]) != kMagic ||
+            static_cast<unsigned char>(first[1]) != kVersion)
+            return false;
+        const char* ptr = first + 2;
+        url_record_view rec;
+        if (!decode(ptr, last, rec) || last - ptr < 5)
+            return false;
+        const auto id = static_cast<unsigned char>(*ptr++);
+
+        std::uint32_t sum = 0;
+        for (int i = 0; i < 4; ++i)
+            sum |= static_cast<std::uint32_t>(static_cast<unsigned char>(ptr[i])) << (8 * i);
+        if (sum != checksum(first, ptr))
+            return false;
+
+        if (!assign_checked(u, rec, id))
+            return false;
+        first = ptr + 4;
+        return true;
+    }
+
+    // Checks the decoded record's scheme id and flags, and assigns the
+    // record to the URL if they are consistent
+    static bool assign_checked(url& u, const url_record_view& rec, unsigned id) {
+        const url::scheme_info* scheme_inf = nullptr;
+        if (!check(rec, id, scheme_inf))
+            return false;
+        assign(u, rec, scheme_inf);
+        return true;
+    }
+};
+
+} // namespace detail
+
+
+/// @brief Appends binary encoded URL record to the string
+///
+/// The record contains the serialized URL, and the offsets of its parts,
+/// flags and scheme id, so read_url_record() restores the URL without
+/// reparsing. The encoding:
+/// * byte: magic 0x55 (`U`)
+/// * byte: format version, 1
+/// * varint: length of the serialized URL
+/// * bytes: serialized URL
+/// * varint: URL's flags; bits 0-7: not null scheme, username, password,
+///   host, port, path, query and fragment; bit 8: opaque path; bit 9: valid
+///   URL; bits 10-12: upa::HostType value
+/// * varint: number of path segments
+/// * varints: one per URL's part; 0 for a trailing part which is not
+///   serialized, otherwise the part's length including its delimiters + 1
+/// * byte: scheme id: 0 for not special scheme, otherwise 1 - 6 for "ftp",
+///   "file", "http", "https", "ws" and "wss"
+/// * 4 bytes: 32-bit FNV-1a hash of all preceding record's bytes, little
+///   endian
+///
+/// All varints are unsigned LEB128. Records can be concatenated.
+///
+/// @param[in]  u   URL to encode
+/// @param[out] out string to append record to
+inline void write_url_record(const url& u, std::string& out) {
+    detail::url_record::write(u, out);
+}
+
+/// @brief Reads binary encoded URL record
+///
+/// Reads the record written by write_url_record() and restores the URL
+/// without reparsing. The record is rejected if it is truncated, if its
+/// checksum does not match, or if its part offsets, flags or scheme id are
+/// inconsistent with the serialized URL. The serialized URL itself is not
+/// validated, so records must come from write_url_record().
+///
+/// @param[in,out] first pointer to the record start; on success it is set
+///   past the record
+/// @param[in]     last  end of input
+/// @param[out]    u     restored URL; on failure it is unchanged
+/// @return `true` on success, `false` if the record is rejected
+inline bool read_url_record(const char*& first, const char* last, url& u) {
+    return detail::url_record::read(first, last, u);
+}
+
+/// @brief Reads binary encoded URL record
+///
+/// @param[in]  data binary encoded record, written by write_url_record()
+/// @param[out] u    restored URL; on failure it is unchanged
+/// @return `true` on success, `false` if the record is rejected or the
+///   @a data contains more bytes than the record
+inline bool read_url_record(string_view data, url& u) {
+    const char* first = data.data();
+    const char* last = first + data.length();
+    return read_url_record(first, last, u) && first == last;
+}
+
+
+} // namespace upa
+
+#endif // UPA_URL_RECORD_H
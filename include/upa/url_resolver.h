@@ -0,0 +1,247 @@
+// Copyright 2016-2024 Rimas Misevičius
+// Distributed under the BSD-style license that can be
+// found in the LICENSE file.
+//
+// This file is included at the end of url.h, but it can also be
+// included on its own.
+//
+
+#ifndef UPA_URL_RESOLVER_H
+#define UPA_URL_RESOLVER_H
+
+#include "url.h"
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+
+namespace upa {
+
+/// @brief Resolves many URL strings against the same base URL
+///
+/// The base URL's parts that relative references copy (the authority, the
+/// path without its last segment, the path, and the path with the query)
+/// are located once in the constructor. Relative references that start
+/// with "?", "#", a single "/", or a path segment are then resolved by
+/// copying one base prefix and parsing the rest of the input. Other inputs
+/// (absolute URLs, scheme-relative references, inputs containing ASCII tab
+/// or newline, or any input if the base URL is a "file" URL or has an opaque
+/// path) are parsed with the basic URL parser.
+///
+/// The result is always the same as of `upa::url(str_url, base)`.
+class base_url_resolver {
+public:
+    /// @brief Constructs resolver from the base URL
+    /// @param[in] base base URL
+    explicit base_url_resolver(const url& base);
+
+    /// @brief Constructs resolver from the base URL
+    /// @param[in] base base URL to move
+    explicit base_url_resolver(url&& base);
+
+    /// @return base URL
+    const url& base() const noexcept { return base_; }
+
+    /// @brief Resolves URL string against the base URL
+    ///
+    /// @param[in]  str_url URL string to parse
+    /// @param[out] out     resolved URL
+    /// @return error code (@a validation_errc::ok on success)
+    template <class T, enable_if_str_arg_t<T> = 0>
+    validation_errc resolve(T&& str_url, url& out) const;
+
+    /// @brief Resolves URL string against the base URL
+    ///
+    /// Throws url_error exception on parse error.
+    ///
+    /// @param[in] str_url URL string to parse
+    /// @return resolved URL
+    template <class T, enable_if_str_arg_t<T> = 0>
+    url resolve(T&& str_url) const;
+
+    /// @brief Resolves a range of URL strings against the base URL
+    ///
+    /// Only successfully resolved URLs are written to the output.
+    ///
+    /// @param[in] first, last range of URL strings
+    /// @param[in] d_first     output iterator to write resolved `upa::url` objects
+    /// @return output iterator past the last written URL
+    template <class InputIt, class OutputIt>
+    OutputIt resolve_all(InputIt first, InputIt last, OutputIt d_first) const;
+
+private:
+    enum PrefixType {
+        BASE_AUTHORITY = 0,   // for "/path"
+        BASE_DIRECTORY,       // for "path"
+        BASE_PATH,            // for "?query"
+        BASE_QUERY,           // for "#fragment" and the empty input
+        BASE_PREFIX_COUNT
+    };
+
+    struct base_prefix {
+        url::PartType last_pt;
+        std::size_t end;
+        std::size_t path_segment_count;
+    };
+
+    void init();
+    void init_prefix(PrefixType ind, url::PartType pt, detail::url_serializer::PathOpFn pathOpFn = nullptr);
+
+    template <typename CharT>
+    validation_errc do_resolve(const CharT* first, const CharT* last, url& out) const;
+
+private:
+    url base_;
+    bool use_prefixes_ = false;
+    base_prefix prefixes_[BASE_PREFIX_COUNT] = {};
+};
+
+
+// base_url_resolver class
+
+inline base_url_resolver::base_url_resolver(const url& base)
+    : base_(base)
+{
+    init();
+}
+
+inline base_url_resolver::base_url_resolver(url&& base)
+    : base_(std::move(base))
+{
+    init();
+}
+
+inline void base_url_resolver::init() {
+    // "file" URLs have own relative resolution rules, and only a fragment can be
+    // resolved against the URL with an opaque path
+    use_prefixes_ = base_.is_valid() && !base_.is_file_scheme() && !base_.has_opaque_path();
+    if (use_prefixes_) {
+        init_prefix(BASE_AUTHORITY, url::PORT);
+        init_prefix(BASE_DIRECTORY, url::PATH, &url::get_path_rem_last);
+        init_prefix(BASE_PATH, url::PATH);
+        init_prefix(BASE_QUERY, url::QUERY);
+    }
+}
+
+// The same base parts as url_serializer::append_parts(base_, url::USERNAME, pt, pathOpFn)
+// copies
+inline void base_url_resolver::init_prefix(PrefixType ind, url::PartType pt, detail::url_serializer::PathOpFn pathOpFn) {
+    int ilast = pt;
+    for (; ilast > url::SCHEME; --ilast) {
+        if (base_.part_end_[ilast])
+            break;
+    }
+    base_prefix& pref = prefixes_[ind];
+    pref.last_pt = static_cast<url::PartType>(ilast);
+    pref.end = base_.part_end_[ilast];
+    pref.path_segment_count = 0;
+    if (ilast >= url::PATH) {
+        pref.path_segment_count = base_.path_segment_count_;
+        if (pathOpFn && ilast == url::PATH)
+            (base_.*pathOpFn)(pref.end, pref.path_segment_count);
+    }
+}
+
+template <class T, enable_if_str_arg_t<T>>
+inline validation_errc base_url_resolver::resolve(T&& str_url, url& out) const {
+    const auto inp = make_str_arg(std::forward<T>(str_url));
+    return do_resolve(inp.begin(), inp.end(), out);
+}
+
+template <class T, enable_if_str_arg_t<T>>
+inline url base_url_resolver::resolve(T&& str_url) const {
+    url u;
+    const auto res = resolve(std::forward<T>(str_url), u);
+    if (res != validation_errc::ok)
+        throw url_error(res, detail::kURLParseError);
+    return u;
+}
+
+template <class InputIt, class OutputIt>
+inline OutputIt base_url_resolver::resolve_all(InputIt first, InputIt last, OutputIt d_first) const {
+    for (; first != last; ++first) {
+        url u;
+        if (resolve(*first, u) == validation_errc::ok) {
+            *d_first = std::move(u);
+            ++d_first;
+        }
+    }
+    return d_first;
+}
+
+template <typename CharT>
+inline validation_errc base_url_resolver::do_resolve(const CharT* first, const CharT* last, url& out) const {
+    using detail::url_parser;
+
+    if (!use_prefixes_)
+        return out.do_parse(first, last, &base_);
+
+    // remove any leading and trailing C0 control or space
+    detail::do_trim(first, last);
+    // the ASCII tab or newline can be anywhere, even in the scheme
+    if (std::any_of(first, last, detail::is_removable_char<CharT>))
+        return out.do_parse(first, last, &base_);
+
+    const bool is_special = base_.is_special_scheme();
+    const auto is_slash = [is_special](CharT c) {
+        return c == '/' || (is_special && c == '\\');
+    };
+
+    // choose the base prefix and the state to parse the rest of input
+    auto pointer = first;
+    PrefixType prefix_type = BASE_QUERY;
+    url_parser::State state = url_parser::not_set_state;
+    if (pointer != last) {
+        switch (*pointer) {
+        case '?':
+            prefix_type = BASE_PATH;
+            state = url_parser::query_state;
+            ++pointer;
+            break;
+        case '#':
+            prefix_type = BASE_QUERY;
+            state = url_parser::fragment_state;
+            ++pointer;
+            break;
+        default:
+            if (is_slash(*pointer)) {
+                // scheme-relative URL
+                if (last - pointer > 1 && is_slash(pointer[1]))
+                    return out.do_parse(first, last, &base_);
+                prefix_type = BASE_AUTHORITY;
+                ++pointer;
+            } else {
+                // absolute URL
+                if (detail::is_first_scheme_char(*pointer)) {
+                    const auto end_of_scheme = std::find_if_not(pointer + 1, last, detail::is_scheme_char<CharT>);
+                    if (end_of_scheme != last && *end_of_scheme == ':')
+                        return out.do_parse(first, last, &base_);
+                }
+                prefix_type = BASE_DIRECTORY;
+            }
+            state = url_parser::path_state;
+            break;
+        }
+    }
+
+    const base_prefix& pref = prefixes_[prefix_type];
+    const validation_errc res = [&]() {
+        detail::url_serializer urls(out);
+
+        // reset URL
+        urls.new_url();
+        urls.reserve(pref.end + static_cast<std::size_t>(last - pointer) + 32);
+
+        urls.copy_prefix(base_, pref.last_pt, pref.end, pref.path_segment_count);
+        if (state == url_parser::not_set_state)
+            return validation_errc::ok; // EOF
+        return url_parser::url_parse(urls, pointer, last, nullptr, url_parser::not_set_state, state);
+    }();
+    if (res == validation_errc::ok)
+        out.set_parsed();
+    return res;
+}
+
+
+} // namespace upa
+
+#endif // UPA_URL_RESOLVER_H
@@ -1,4 +1,4 @@
-// Copyright 2016-2023 Rimas Misevičius
+// Copyright 2016-2024 Rimas Misevičius
 // Distributed under the BSD-style license that can be
 // found in the LICENSE file.
 //
@@ -6,7 +6,9 @@
 #ifndef UPA_URL_RESULT_H
 #define UPA_URL_RESULT_H
 
+#include <cstddef>
 #include <stdexcept>
+#include <type_traits>
 
 namespace upa {
 
@@ -93,6 +95,21 @@ constexpr bool success(validation_errc res) noexcept {
     return res == validation_errc::ok;
 }
 
+/// @brief Validation error sink which ignores errors
+///
+/// It is the default sink of the URL parser: the parser code, which detects
+/// non-failure validation errors, is not compiled in when this sink is used.
+/// Any other sink is a function object called as
+/// `sink(validation_errc err, std::size_t offset)`.
+struct null_validation_sink {
+    void operator()(validation_errc, std::size_t) const noexcept {}
+};
+
+/// @brief Checks the URL parser reports validation errors to the Sink
+template <class Sink>
+struct is_validation_sink_enabled : std::integral_constant<bool,
+    !std::is_same<typename std::decay<Sink>::type, null_validation_sink>::value> {};
+
 /// @brief URL exception class
 
 class url_error : public std::runtime_error {
@@ -116,6 +133,19 @@ class url_error : public std::runtime_error {
 
 namespace detail {
 
+// Validation error reporter, which ignores errors. The host and IPv4 parsers
+// take the reporter, and detect non-failure validation errors only if its
+// `enabled` is true.
+struct null_validation_reporter {
+    static const bool enabled = false;
+
+    template <typename CharT>
+    void operator()(validation_errc, const CharT*) const noexcept {}
+
+    template <typename CharT>
+    void check_url_units(const CharT*, const CharT*, bool) const noexcept {}
+};
+
 /// @brief Result/value pair
 
 template<typename T, typename R = bool>
@@ -23,6 +23,11 @@ inline url_search_params::url_search_params(url* url_ptr)
 {}
 
 inline void url_search_params::update() {
+    if (edit_count_) {
+        // update URL when the last transaction is committed
+        is_update_pending_ = true;
+        return;
+    }
     if (url_ptr_ && url_ptr_->is_valid()) {
         detail::url_setter urls(*url_ptr_);
 
@@ -9,13 +9,20 @@
 #include "config.h"
 #include "str_arg.h"
 #include "url_percent_encode.h"
+#include "url_tracing.h"
 #include "url_utf.h"
+#include "util.h"
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <iterator>
 #include <list>
 #include <memory>
 #include <string>
 #include <type_traits>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
 namespace upa {
 
@@ -55,6 +62,82 @@ using enable_if_not_base_of_t = typename std::enable_if<
     !std::is_base_of<Base, typename std::decay<T>::type>::value, int
 >::type;
 
+// hash function object for string_view keys
+struct string_view_hash {
+    std::size_t operator()(string_view str) const noexcept {
+        return static_cast<std::size_t>(util::hash_bytes(str.data(), str.length()));
+    }
+};
+
+// Sorts indices of the keys stored in contiguous memory, preserving the order
+// of equal keys. The key i is [keys[key_start[i]], keys[key_start[i + 1]]),
+// keys are compared by code units.
+template <class CharT>
+inline void stable_sort_by_keys(std::vector<std::size_t>& order,
+    const std::basic_string<CharT>& keys, const std::vector<std::size_t>& key_start)
+{
+    const CharT* data = keys.data();
+    std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+        const std::size_t len_a = key_start[a + 1] - key_start[a];
+        const std::size_t len_b = key_start[b + 1] - key_start[b];
+        const int cmp = std::char_traits<CharT>::compare(
+            data + key_start[a], data + key_start[b], std::min(len_a, len_b));
+        return cmp < 0 || (cmp == 0 && len_a < len_b);
+    });
+}
+
+// application/x-www-form-urlencoded parsing helpers
+// https://url.spec.whatwg.org/#concept-urlencoded-parser
+
+// Replaces U+002B (+) with 0x20 (SP), percent decodes the name or value in
+// [first, last) and appends the result to the `output`
+inline void append_form_urlencoded_decoded(std::string& output, const char* first, const char* last) {
+    for (auto it = first; it != last; ++it) {
+        switch (*it) {
+        case '+':
+            output.push_back(' ');
+            break;
+        case '%':
+            if (last - it > 2) {
+                const auto uc1 = static_cast<unsigned char>(it[1]);
+                const auto uc2 = static_cast<unsigned char>(it[2]);
+                if (is_hex_char(uc1) && is_hex_char(uc2)) {
+                    output.push_back(static_cast<char>((hex_char_to_num(uc1) << 4) + hex_char_to_num(uc2)));
+                    it += 2;
+                    break;
+                }
+            }
+            UPA_FALLTHROUGH
+        default:
+            output.push_back(*it);
+            break;
+        }
+    }
+}
+
+// Decodes the name or value in [first, last), and replaces invalid UTF-8 byte
+// sequences with U+FFFD. Returns the view of [first, last) if it does not need
+// decoding, otherwise decodes it to the `buff` and returns the view of `buff`.
+inline string_view form_urlencoded_decode(const char* first, const char* last, std::string& buff) {
+    bool is_ascii = true;
+    for (auto it = first; it != last; ++it) {
+        const auto uc = static_cast<unsigned char>(*it);
+        if (uc == '+' || uc == '%') {
+            buff.clear();
+            append_form_urlencoded_decoded(buff, first, last);
+            url_utf::check_fix_utf8(buff);
+            return buff;
+        }
+        if (uc >= 0x80)
+            is_ascii = false;
+    }
+    if (is_ascii || url_utf::is_valid_utf8(first, last))
+        return { first, static_cast<std::size_t>(last - first) };
+    buff.assign(first, last);
+    url_utf::check_fix_utf8(buff);
+    return buff;
+}
+
 } // namespace detail
 
 
@@ -70,6 +153,12 @@ namespace detail {
 /// Follows specification in
 /// https://url.spec.whatwg.org/#interface-urlsearchparams
 ///
+/// Lookups by name in lists of 16 or more name-value pairs use the hash
+/// index, which maps names to their name-value pairs. It is built on the
+/// first such lookup and invalidated on most modifications. The index built
+/// by a `const` member function is published atomically, so `const` member
+/// functions can be called concurrently.
+///
 class url_search_params
 {
 public:
@@ -83,6 +172,8 @@ class url_search_params
     using size_type = name_value_list::size_type;
     using value_type = name_value_pair;
 
+    class transaction;
+
     // Constructors
 
     /// @brief Default constructor.
@@ -129,7 +220,7 @@ class url_search_params
     }
 
     /// destructor
-    ~url_search_params() = default;
+    ~url_search_params() { invalidate_index(); }
 
     // Assignment
 
@@ -295,6 +386,23 @@ class url_search_params
     /// More info: https://url.spec.whatwg.org/#dom-urlsearchparams-sort
     void sort();
 
+    /// Starts a batch of modifications.
+    ///
+    /// While the returned transaction object (or any other transaction of this
+    /// object) is not committed, modifications do not update the connected URL.
+    /// The URL is updated once, when the last transaction is committed.
+    ///
+    /// Example:
+    /// @code
+    /// auto tx = url.search_params().edit();
+    /// tx->append("utm_source", "news");
+    /// tx->append("utm_medium", "email");
+    /// tx.commit();
+    /// @endcode
+    ///
+    /// @return transaction object, which commits modifications when destroyed
+    transaction edit() noexcept;
+
     /// Serializes name-value pairs to string and appends it to @a query.
     ///
     /// @param[in,out] query
@@ -369,20 +477,92 @@ class url_search_params
     void move_params(url_search_params&& other) UPA_NOEXCEPT_17;
     void parse_params(string_view query);
 
+    // name index
+    static constexpr size_type kIndexMinSize = 16;
+    using index_entry = std::vector<name_value_list::iterator>;
+    using name_index = std::unordered_map<string_view, index_entry, detail::string_view_hash>;
+
+    name_index* get_index() const;
+    const index_entry* find_in_index(string_view name) const;
+    void invalidate_index() noexcept {
+        delete index_.exchange(nullptr, std::memory_order_relaxed); // NOLINT(cppcoreguidelines-owning-memory)
+    }
+
+    void sort_params();
+    size_type remove_name(string_view name);
+
     void update();
 
     friend class url;
     friend class detail::url_search_params_ptr;
+    friend class transaction;
+    friend class lazy_search_params;
 
 private:
     name_value_list params_;
+    // name index; it is built on demand and owned by this object
+    mutable std::atomic<name_index*> index_{ nullptr };
     bool is_sorted_ = false;
+    // batch of modifications
+    bool is_update_pending_ = false;
+    unsigned edit_count_ = 0;
     url* url_ptr_ = nullptr;
 
     static const char kEncByte[0x100];
 };
 
 
+/// @brief The batch of url_search_params modifications
+///
+/// It is returned by url_search_params::edit() and defers the update of the
+/// connected URL until commit() is called or the transaction is destroyed.
+class url_search_params::transaction {
+public:
+    /// @brief Move constructor.
+    ///
+    /// @param[in,out] other transaction to move from; it is no longer active
+    transaction(transaction&& other) noexcept
+        : params_(other.params_)
+    {
+        other.params_ = nullptr;
+    }
+
+    transaction(const transaction&) = delete;
+    transaction& operator=(const transaction&) = delete;
+    transaction& operator=(transaction&&) = delete;
+
+    /// @brief Destructor.
+    ///
+    /// Commits the transaction if it is still active. If the URL update fails
+    /// here, then std::terminate is called; call commit() to handle errors.
+    ~transaction() {
+        commit();
+    }
+
+    /// Commits the transaction: if it is the last active transaction, then
+    /// updates the connected URL (if there are pending modifications).
+    void commit();
+
+    /// @return the url_search_params object being modified
+    url_search_params& operator*() const noexcept { return *params_; }
+
+    /// @return pointer to the url_search_params object being modified
+    url_search_params* operator->() const noexcept { return params_; }
+
+private:
+    explicit transaction(url_search_params& params) noexcept
+        : params_(&params)
+    {
+        ++params_->edit_count_;
+    }
+
+    friend class url_search_params;
+
+private:
+    url_search_params* params_;
+};
+
+
 namespace detail {
 
 class url_search_params_ptr
@@ -477,8 +657,7 @@ inline url_search_params& url_search_params::safe_assign(url_search_params&& oth
 // Operations
 
 inline void url_search_params::clear() {
-    params_.clear();
-    is_sorted_ = true;
+    clear_params();
     update();
 }
 
@@ -488,31 +667,91 @@ inline void url_search_params::swap(url_search_params& other) UPA_NOEXCEPT_17 {
     using std::swap;
 
     swap(params_, other.params_);
+    invalidate_index();
+    other.invalidate_index();
     swap(is_sorted_, other.is_sorted_);
 }
 
 inline void url_search_params::clear_params() noexcept {
+    invalidate_index();
+    is_update_pending_ = false;
     params_.clear();
     is_sorted_ = true;
 }
 
 inline void url_search_params::copy_params(const url_search_params& other) {
+    invalidate_index();
     params_ = other.params_;
     is_sorted_ = other.is_sorted_;
 }
 
 inline void url_search_params::move_params(url_search_params&& other) UPA_NOEXCEPT_17 {
+    invalidate_index();
     params_ = std::move(other.params_);
     is_sorted_ = other.is_sorted_;
 }
 
 inline void url_search_params::parse_params(string_view query) {
+    invalidate_index();
+    is_update_pending_ = false;
     params_ = do_parse(false, query);
     is_sorted_ = false;
 }
 
+// Returns the name index, and builds it if needed. Returns `nullptr` if the
+// list is too small to use the index.
+inline url_search_params::name_index* url_search_params::get_index() const {
+    name_index* index = index_.load(std::memory_order_acquire);
+    if (!index && params_.size() >= kIndexMinSize) {
+        // the index stores non-const iterators, which are used to modify the
+        // list only by non-const member functions
+        auto& params = const_cast<name_value_list&>(params_); // NOLINT(cppcoreguidelines-pro-type-const-cast)
+        std::unique_ptr<name_index> new_index(new name_index(params.size())); // NOLINT(cppcoreguidelines-owning-memory)
+        for (auto it = params.begin(); it != params.end(); ++it)
+            (*new_index)[it->first].push_back(it);
+        // publish the index, unless another thread has published its own first
+        if (index_.compare_exchange_strong(index, new_index.get(),
+            std::memory_order_acq_rel, std::memory_order_acquire))
+            index = new_index.release();
+    }
+    return index;
+}
+
+// Returns the index entry of name-value pairs whose name is `name`, or
+// `nullptr` if there are no such pairs
+inline const url_search_params::index_entry* url_search_params::find_in_index(string_view name) const {
+    const name_index* index = index_.load(std::memory_order_acquire);
+    assert(index);
+    const auto it = index->find(name);
+    return it != index->end() ? &it->second : nullptr;
+}
+
+// Removes all name-value pairs whose name is `name` without updating URL.
+// Returns the number of pairs removed.
+inline url_search_params::size_type url_search_params::remove_name(string_view name) {
+    name_index* index = get_index();
+    if (index) {
+        const auto iti = index->find(name);
+        if (iti == index->end())
+            return 0;
+        const index_entry entry = std::move(iti->second);
+        // the key refers to the name of the first pair, so erase it first
+        index->erase(iti);
+        for (const auto it : entry)
+            params_.erase(it);
+        return entry.size();
+    }
+
+    const size_type old_size = params_.size();
+    params_.remove_if([&](const value_type& item) {
+        return item.first == name;
+    });
+    return old_size - params_.size();
+}
+
 template <class StrT, enable_if_str_arg_t<StrT>>
 inline void url_search_params::parse(StrT&& query) {
+    invalidate_index();
     params_ = do_parse(true, std::forward<StrT>(query));
     is_sorted_ = false;
     update();
@@ -520,6 +759,7 @@ inline void url_search_params::parse(StrT&& query) {
 
 template <class TN, class TV>
 inline void url_search_params::append(TN&& name, TV&& value) {
+    invalidate_index();
     params_.emplace_back(
         make_string(std::forward<TN>(name)),
         make_string(std::forward<TV>(value))
@@ -532,14 +772,13 @@ template <class TN>
 inline void url_search_params::del(const TN& name) {
     const auto str_name = make_string(name);
 
-    params_.remove_if([&](const value_type& item) {
-        return item.first == str_name;
-    });
+    remove_name(str_name);
     update();
 }
 
 template <class TN, class TV>
 inline void url_search_params::del(const TN& name, const TV& value) {
+    invalidate_index();
     const auto str_name = make_string(name);
     const auto str_value = make_string(value);
 
@@ -553,9 +792,9 @@ template <class TN>
 inline url_search_params::size_type url_search_params::remove(const TN& name) {
     const auto str_name = make_string(name);
 
-    return remove_if([&](const value_type& item) {
-        return item.first == str_name;
-    });
+    const size_type count = remove_name(str_name);
+    if (count) update();
+    return count;
 }
 
 template <class TN, class TV>
@@ -570,6 +809,7 @@ inline url_search_params::size_type url_search_params::remove(const TN& name, co
 
 template <class UnaryPredicate>
 inline url_search_params::size_type url_search_params::remove_if(UnaryPredicate p) {
+    invalidate_index();
 #ifdef __cpp_lib_list_remove_return_type
     const size_type count = params_.remove_if(p);
 #else
@@ -584,6 +824,10 @@ inline url_search_params::size_type url_search_params::remove_if(UnaryPredicate
 template <class TN>
 inline const std::string* url_search_params::get(const TN& name) const {
     const auto str_name = make_string(name);
+    if (get_index()) {
+        const index_entry* entry = find_in_index(str_name);
+        return entry ? &entry->front()->second : nullptr;
+    }
     for (const auto& p : params_) {
         if (p.first == str_name)
             return &p.second;
@@ -595,6 +839,14 @@ template <class TN>
 inline std::list<std::string> url_search_params::get_all(const TN& name) const {
     std::list<std::string> lst;
     const auto str_name = make_string(name);
+    if (get_index()) {
+        const index_entry* entry = find_in_index(str_name);
+        if (entry) {
+            for (const auto it : *entry)
+                lst.push_back(it->second);
+        }
+        return lst;
+    }
     for (const auto& p : params_) {
         if (p.first == str_name)
             lst.push_back(p.second);
@@ -605,6 +857,8 @@ inline std::list<std::string> url_search_params::get_all(const TN& name) const {
 template <class TN>
 inline bool url_search_params::has(const TN& name) const {
     const auto str_name = make_string(name);
+    if (get_index())
+        return find_in_index(str_name) != nullptr;
     for (const auto& p : params_) {
         if (p.first == str_name)
             return true;
@@ -617,6 +871,16 @@ inline bool url_search_params::has(const TN& name, const TV& value) const {
     const auto str_name = make_string(name);
     const auto str_value = make_string(value);
 
+    if (get_index()) {
+        const index_entry* entry = find_in_index(str_name);
+        if (entry) {
+            for (const auto it : *entry) {
+                if (it->second == str_value)
+                    return true;
+            }
+        }
+        return false;
+    }
     for (const auto& p : params_) {
         if (p.first == str_name && p.second == str_value)
             return true;
@@ -629,6 +893,22 @@ inline void url_search_params::set(TN&& name, TV&& value) {
     auto str_name = make_string(std::forward<TN>(name));
     auto str_value = make_string(std::forward<TV>(value));
 
+    name_index* index = get_index();
+    if (index) {
+        const auto iti = index->find(str_name);
+        if (iti == index->end()) {
+            append(std::move(str_name), std::move(str_value));
+            return;
+        }
+        index_entry& entry = iti->second;
+        entry.front()->second = std::move(str_value);
+        for (auto it = std::next(entry.begin()); it != entry.end(); ++it)
+            params_.erase(*it);
+        entry.resize(1);
+        update();
+        return;
+    }
+
     bool is_match = false;
     for (auto it = params_.begin(); it != params_.end(); ) {
         if (it->first == str_name) {
@@ -652,80 +932,98 @@ inline void url_search_params::sort() {
     // Sorting must be done by comparison of code units. The relative order
     // between name-value pairs with equal names must be preserved.
     if (!is_sorted_) {
-        // https://en.cppreference.com/w/cpp/container/list/sort
-        // std::list::sort preserves the order of equal elements.
-        params_.sort([](const name_value_pair& a, const name_value_pair& b) {
-            //return a.first < b.first;
-            return url_utf::compare_by_code_units(
-                a.first.data(), a.first.data() + a.first.size(),
-                b.first.data(), b.first.data() + b.first.size()) < 0;
-        });
+        invalidate_index();
+        sort_params();
         is_sorted_ = true;
     }
     update();
 }
 
+// Sorts name-value pairs by their names. The names are copied to contiguous
+// memory as UTF-16 code units (or as bytes, if all names are ASCII), then
+// indices of pairs are sorted with std::stable_sort, and finally the list
+// nodes are relinked in the sorted order.
+inline void url_search_params::sort_params() {
+    const std::size_t count = params_.size();
+    if (count < 2)
+        return;
+
+    std::vector<name_value_list::iterator> items;
+    std::vector<std::size_t> key_start;
+    items.reserve(count);
+    key_start.reserve(count + 1);
+
+    bool is_ascii = true;
+    std::size_t keys_size = 0;
+    for (auto it = params_.begin(); it != params_.end(); ++it) {
+        items.push_back(it);
+        keys_size += it->first.length();
+        if (is_ascii) {
+            is_ascii = std::all_of(it->first.begin(), it->first.end(), [](char c) {
+                return static_cast<unsigned char>(c) < 0x80;
+            });
+        }
+    }
+
+    std::vector<std::size_t> order(count);
+    for (std::size_t ind = 0; ind < count; ++ind)
+        order[ind] = ind;
+
+    if (is_ascii) {
+        std::string keys;
+        keys.reserve(keys_size);
+        key_start.push_back(0);
+        for (const auto it : items) {
+            keys.append(it->first);
+            key_start.push_back(keys.length());
+        }
+        detail::stable_sort_by_keys(order, keys, key_start);
+    } else {
+        std::u16string keys;
+        keys.reserve(keys_size);
+        key_start.push_back(0);
+        simple_buffer<char16_t> buff;
+        for (const auto it : items) {
+            buff.clear();
+            url_utf::convert_utf8_to_utf16(it->first.data(), it->first.data() + it->first.length(), buff);
+            keys.append(buff.data(), buff.size());
+            key_start.push_back(keys.length());
+        }
+        detail::stable_sort_by_keys(order, keys, key_start);
+    }
+
+    // relink nodes in the sorted order
+    for (const auto ind : order)
+        params_.splice(params_.end(), params_, items[ind]);
+}
+
 template <class StrT, enable_if_str_arg_t<StrT>>
 inline url_search_params::name_value_list url_search_params::do_parse(bool rem_qmark, StrT&& query) {
+    UPA_TRACE_SCOPE("url_search_params::parse");
     name_value_list lst;
 
     const auto str_query = make_string(std::forward<StrT>(query));
-    auto b = str_query.begin();
-    const auto e = str_query.end();
+    const char* first = str_query.data();
+    const char* const last = first + str_query.length();
 
     // remove leading question-mark?
-    if (rem_qmark && b != e && *b == '?')
-        ++b;
-
-    std::string name;
-    std::string value;
-    std::string* pval = &name;
-    auto start = b;
-    for (auto it = b; it != e; ++it) {
-        switch (*it) {
-        case '=':
-            if (pval != &value)
-                pval = &value;
-            else
-                pval->push_back(*it);
-            break;
-        case '&':
-            if (start != it) {
-                url_utf::check_fix_utf8(name);
-                url_utf::check_fix_utf8(value);
-                lst.emplace_back(std::move(name), std::move(value));
-                // clear after move
-                name.clear();
-                value.clear();
-            }
-            pval = &name;
-            start = it + 1; // skip '&'
-            break;
-        case '+':
-            pval->push_back(' ');
-            break;
-        case '%':
-            if (std::distance(it, e) > 2) {
-                auto itc = it;
-                const auto uc1 = static_cast<unsigned char>(*(++itc));
-                const auto uc2 = static_cast<unsigned char>(*(++itc));
-                if (detail::is_hex_char(uc1) && detail::is_hex_char(uc2)) {
-                    const char c = static_cast<char>((detail::hex_char_to_num(uc1) << 4) + detail::hex_char_to_num(uc2));
-                    pval->push_back(c);
-                    it = itc;
-                    break;
-                }
-            }
-            UPA_FALLTHROUGH
-        default:
-            pval->push_back(*it);
-            break;
+    if (rem_qmark && first != last && *first == '?')
+        ++first;
+
+    while (first != last) {
+        const char* const end = std::find(first, last, '&');
+        if (first != end) {
+            const char* const name_end = std::find(first, end, '=');
+            std::string name;
+            std::string value;
+            detail::append_form_urlencoded_decoded(name, first, name_end);
+            if (name_end != end)
+                detail::append_form_urlencoded_decoded(value, name_end + 1, end);
+            url_utf::check_fix_utf8(name);
+            url_utf::check_fix_utf8(value);
+            lst.emplace_back(std::move(name), std::move(value));
         }
-    }
-    if (start != e) {
-        url_utf::check_fix_utf8(name);
-        url_utf::check_fix_utf8(value);
-        lst.emplace_back(std::move(name), std::move(value));
+        first = end == last ? last : end + 1; // skip '&'
     }
     return lst;
 }
@@ -765,6 +1063,23 @@ inline std::string url_search_params::to_string() const {
     return query;
 }
 
+inline url_search_params::transaction url_search_params::edit() noexcept {
+    return transaction{ *this };
+}
+
+// url_search_params::transaction inline
+
+inline void url_search_params::transaction::commit() {
+    if (params_) {
+        url_search_params& params = *params_;
+        params_ = nullptr;
+        if (--params.edit_count_ == 0 && params.is_update_pending_) {
+            params.update();
+            params.is_update_pending_ = false;
+        }
+    }
+}
+
 // Non-member functions
 
 /// @brief Swaps the contents of two url_search_params
@@ -781,6 +1096,368 @@ inline void swap(url_search_params& lhs, url_search_params& rhs) UPA_NOEXCEPT_17
 }
 
 
+/// @brief Lazily parsed search parameters
+///
+/// Keeps the query string and decodes it only when needed. The first get() or
+/// has() call scans the query string and decodes only the value of the matching
+/// name-value pair; the repeated lookup or the params() call decodes the whole
+/// name-value list into the url_search_params object.
+///
+/// Unlike url_search_params, even `const` member functions of this class modify
+/// the object, so the concurrent access to the same object requires
+/// synchronization.
+///
+class lazy_search_params {
+public:
+    /// @brief Default constructor.
+    ///
+    /// Constructs empty @c lazy_search_params object.
+    lazy_search_params() = default;
+
+    /// @brief Parsing constructor.
+    ///
+    /// Stores query string to parse on demand.
+    ///
+    /// @param[in] query string to parse; if it starts with U+003F (?), then the
+    ///   first code point is skipped
+    template <class StrT, enable_if_str_arg_t<StrT> = 0>
+    explicit lazy_search_params(StrT&& query) {
+        const auto str_query = make_string(std::forward<StrT>(query));
+        string_view query_view(str_query.data(), str_query.length());
+        // remove leading question-mark
+        if (!query_view.empty() && query_view[0] == '?')
+            query_view = string_view(query_view.data() + 1, query_view.length() - 1);
+        query_.assign(query_view.data(), query_view.length());
+        is_parsed_ = query_.empty();
+    }
+
+    /// Returns the value of the first name-value pair whose name is @a name
+    ///
+    /// @param[in] name
+    /// @return the pointer to the value of the first name-value pair whose name
+    ///   is @a name, or `nullptr` if there is no such pair
+    template <class TN>
+    const std::string* get(const TN& name) const;
+
+    /// Tests if list contains a name-value pair whose name is @a name
+    ///
+    /// @param[in] name
+    /// @return `true`, if list contains such pair, `false` otherwise
+    template <class TN>
+    bool has(const TN& name) const;
+
+    /// Decodes the whole name-value list, if it is not decoded yet.
+    ///
+    /// @return the reference to decoded name-value list
+    const url_search_params& params() const;
+
+    /// Decodes the whole name-value list, if it is not decoded yet.
+    ///
+    /// @return the reference to decoded name-value list, which can be modified
+    url_search_params& params();
+
+private:
+    bool is_first_lookup() const noexcept;
+    bool find_in_query(string_view name, std::string* value) const;
+
+private:
+    // name-value list; it is empty until the query_ is parsed
+    mutable url_search_params params_;
+    // not yet parsed query string
+    mutable std::string query_;
+    // the value found by the first lookup in the not yet parsed query_
+    mutable std::string lookup_value_;
+    mutable bool is_parsed_ = true;
+    mutable bool is_looked_up_ = false;
+};
+
+// lazy_search_params inline
+
+template <class TN>
+inline const std::string* lazy_search_params::get(const TN& name) const {
+    if (is_first_lookup()) {
+        const auto str_name = make_string(name);
+        return find_in_query(str_name, &lookup_value_) ? &lookup_value_ : nullptr;
+    }
+    return params().get(name);
+}
+
+template <class TN>
+inline bool lazy_search_params::has(const TN& name) const {
+    if (is_first_lookup()) {
+        const auto str_name = make_string(name);
+        return find_in_query(str_name, nullptr);
+    }
+    return params().has(name);
+}
+
+inline const url_search_params& lazy_search_params::params() const {
+    if (!is_parsed_) {
+        params_.params_ = url_search_params::do_parse(false, query_);
+        is_parsed_ = true;
+        // release memory
+        std::string().swap(query_);
+    }
+    return params_;
+}
+
+inline url_search_params& lazy_search_params::params() {
+    static_cast<const lazy_search_params*>(this)->params();
+    return params_;
+}
+
+// Returns `true` only for the first lookup in the not yet parsed query_.
+// The subsequent lookups parse the whole query_.
+inline bool lazy_search_params::is_first_lookup() const noexcept {
+    if (is_parsed_ || is_looked_up_)
+        return false;
+    is_looked_up_ = true;
+    return true;
+}
+
+// Finds the first name-value pair whose name is `name` in the not yet parsed
+// query_, and decodes its value to the `*value` (if `value` is not `nullptr`).
+// It decodes only the names that differ from their raw form.
+inline bool lazy_search_params::find_in_query(string_view name, std::string* value) const {
+    const char* first = query_.data();
+    const char* const last = first + query_.length();
+    std::string buff;
+
+    while (first != last) {
+        const char* const end = std::find(first, last, '&');
+        if (first != end) {
+            const char* const name_end = std::find(first, end, '=');
+            if (detail::form_urlencoded_decode(first, name_end, buff) == name) {
+                if (value) {
+                    value->clear();
+                    if (name_end != end)
+                        detail::append_form_urlencoded_decoded(*value, name_end + 1, end);
+                    url_utf::check_fix_utf8(*value);
+                }
+                return true;
+            }
+        }
+        first = end == last ? last : end + 1; // skip '&'
+    }
+    return false;
+}
+
+
+/// @brief Read-only view of the name-value pairs of a query string
+///
+/// Iterates over the name-value pairs of the application/x-www-form-urlencoded
+/// string without copying it. The names and values are returned as `string_view`s
+/// pointing into the original string, if they do not need decoding. Otherwise
+/// they are decoded into the buffers of the iterator, which are valid until the
+/// iterator is advanced or destroyed.
+///
+/// The viewed string must outlive the view and its iterators.
+///
+/// More info: https://url.spec.whatwg.org/#concept-urlencoded-parser
+///
+class search_params_view {
+public:
+    // types
+    using value_type = std::pair<string_view, string_view>;
+    using size_type = std::size_t;
+
+    class const_iterator;
+    using iterator = const_iterator;
+
+    /// @brief Default constructor.
+    ///
+    /// Constructs the view of an empty string.
+    search_params_view() noexcept = default;
+
+    /// @brief Constructs the view of the @a query string.
+    ///
+    /// @param[in] query string to view; if it starts with U+003F (?), then the
+    ///   first code point is skipped, so the result of the url::search() can be
+    ///   passed
+    explicit search_params_view(string_view query) noexcept;
+
+    /// @return an iterator to the first name-value pair
+    const_iterator begin() const;
+
+    /// @return an iterator to the first name-value pair
+    const_iterator cbegin() const;
+
+    /// @return an iterator past the last name-value pair
+    const_iterator end() const noexcept;
+
+    /// @return an iterator past the last name-value pair
+    const_iterator cend() const noexcept;
+
+    /// Checks whether there are no name-value pairs
+    ///
+    /// @return `true` if there are no name-value pairs, `false` otherwise
+    bool empty() const noexcept;
+
+    /// @return the viewed query string without a leading U+003F (?)
+    string_view query() const noexcept { return query_; }
+
+private:
+    string_view query_;
+};
+
+/// @brief Iterator of the search_params_view name-value pairs
+///
+/// It is an input iterator: the referenced name-value pair can point into
+/// the iterator's own buffers.
+class search_params_view::const_iterator {
+public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = search_params_view::value_type;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const value_type*;
+    using reference = const value_type&;
+
+    /// @brief Default constructor.
+    ///
+    /// Constructs a singular iterator, which is not associated with any view,
+    /// so it is not equal to search_params_view::end(). It can only be
+    /// assigned to, copied or destroyed.
+    const_iterator() noexcept = default;
+
+    /// @brief Copy constructor.
+    ///
+    /// @param[in] other iterator to copy from
+    const_iterator(const const_iterator& other);
+
+    /// @brief Copy assignment.
+    ///
+    /// @param[in] other iterator to copy from
+    /// @return *this
+    const_iterator& operator=(const const_iterator& other);
+
+    /// destructor
+    ~const_iterator() = default;
+
+    reference operator*() const noexcept { return pair_; }
+    pointer operator->() const noexcept { return &pair_; }
+
+    const_iterator& operator++();
+    const_iterator operator++(int);
+
+    friend bool operator==(const const_iterator& lhs, const const_iterator& rhs) noexcept {
+        return lhs.first_ == rhs.first_;
+    }
+    friend bool operator!=(const const_iterator& lhs, const const_iterator& rhs) noexcept {
+        return lhs.first_ != rhs.first_;
+    }
+
+private:
+    const_iterator(const char* first, const char* last);
+
+    void skip_empty_and_decode();
+
+    friend class search_params_view;
+
+private:
+    // current name-value sequence [first_, end_); first_ == last_ at the end
+    const char* first_ = nullptr;
+    const char* end_ = nullptr;
+    const char* last_ = nullptr;
+    value_type pair_;
+    std::string name_buff_;
+    std::string value_buff_;
+};
+
+// search_params_view inline
+
+inline search_params_view::search_params_view(string_view query) noexcept
+    : query_(query)
+{
+    // remove leading question-mark
+    if (!query_.empty() && query_[0] == '?')
+        query_ = string_view(query_.data() + 1, query_.length() - 1);
+}
+
+inline search_params_view::const_iterator search_params_view::begin() const {
+    return { query_.data(), query_.data() + query_.length() };
+}
+
+inline search_params_view::const_iterator search_params_view::cbegin() const {
+    return begin();
+}
+
+inline search_params_view::const_iterator search_params_view::end() const noexcept {
+    const_iterator it;
+    it.first_ = query_.data() + query_.length();
+    it.last_ = it.first_;
+    return it;
+}
+
+inline search_params_view::const_iterator search_params_view::cend() const noexcept {
+    return end();
+}
+
+inline bool search_params_view::empty() const noexcept {
+    return std::all_of(query_.begin(), query_.end(), [](char c) { return c == '&'; });
+}
+
+// search_params_view::const_iterator inline
+
+inline search_params_view::const_iterator::const_iterator(const char* first, const char* last)
+    : first_(first)
+    , end_(first)
+    , last_(last)
+{
+    skip_empty_and_decode();
+}
+
+inline search_params_view::const_iterator::const_iterator(const const_iterator& other)
+    : first_(other.first_)
+    , end_(other.first_)
+    , last_(other.last_)
+{
+    // decode again, because the pair_ may point into the other's buffers
+    skip_empty_and_decode();
+}
+
+inline search_params_view::const_iterator& search_params_view::const_iterator::operator=(const const_iterator& other) {
+    if (this != std::addressof(other)) {
+        first_ = other.first_;
+        end_ = other.first_;
+        last_ = other.last_;
+        skip_empty_and_decode();
+    }
+    return *this;
+}
+
+inline search_params_view::const_iterator& search_params_view::const_iterator::operator++() {
+    // skip '&'
+    first_ = end_ == last_ ? last_ : end_ + 1;
+    end_ = first_;
+    skip_empty_and_decode();
+    return *this;
+}
+
+inline search_params_view::const_iterator search_params_view::const_iterator::operator++(int) {
+    const_iterator tmp(*this);
+    ++(*this);
+    return tmp;
+}
+
+// Skips empty sequences starting at first_, and decodes the name and value of
+// the first non-empty sequence
+inline void search_params_view::const_iterator::skip_empty_and_decode() {
+    while (first_ != last_ && *first_ == '&')
+        ++first_;
+    if (first_ != last_) {
+        end_ = std::find(first_, last_, '&');
+        const char* const name_end = std::find(first_, end_, '=');
+        pair_.first = detail::form_urlencoded_decode(first_, name_end, name_buff_);
+        pair_.second = name_end != end_
+            ? detail::form_urlencoded_decode(name_end + 1, end_, value_buff_)
+            : string_view(end_, 0);
+    } else {
+        end_ = last_;
+        pair_ = value_type{};
+    }
+}
+
+
 } // namespace upa
 
 #endif // UPA_URL_SEARCH_PARAMS_H
@@ -0,0 +1,306 @@
+// Copyright 2016-2024 Rimas Misevičius
+// Distributed under the BSD-style license that can be
+// found in the LICENSE file.
+//
+
+#ifndef UPA_URL_TABLE_H
+#define UPA_URL_TABLE_H
+
+#include "url.h"
+#include "util.h"
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace upa {
+namespace detail {
+
+// Dictionary of distinct strings; the id 0 is reserved for the null value
+
+class string_dictionary {
+public:
+    using id_type = std::uint32_t;
+
+    string_dictionary() : offsets_{ 0, 0 } {}
+
+    // Returns the id of the string; adds the string if it is not in the dictionary
+    id_type intern(string_view str);
+
+    bool find(string_view str, id_type& id) const noexcept;
+
+    // Number of values, including the null value
+    std::size_t size() const noexcept { return offsets_.size() - 1; }
+
+    string_view value(id_type id) const noexcept {
+        return { data_.data() + offsets_[id], offsets_[id + 1] - offsets_[id] };
+    }
+
+    void clear() noexcept;
+
+private:
+    std::size_t find_slot(string_view str, std::uint64_t hash) const noexcept;
+    void grow_table();
+
+private:
+    std::string data_;
+    // value's id is the index of its start offset
+    std::vector<std::size_t> offsets_;
+    // open addressing hash table of value ids; 0 marks an empty slot
+    std::vector<id_type> table_;
+};
+
+inline string_dictionary::id_type string_dictionary::intern(string_view str) {
+    const std::uint64_t hash = util::hash_bytes(str.data(), str.length());
+    if (!table_.empty()) {
+        const std::size_t slot = find_slot(str, hash);
+        if (table_[slot])
+            return table_[slot];
+    }
+    if (size() >= static_cast<id_type>(-1))
+        throw std::length_error("too many values in the url_table column");
+    if (size() * 2 > table_.size())
+        grow_table();
+
+    const auto id = static_cast<id_type>(size());
+    util::append(data_, str);
+    offsets_.push_back(data_.length());
+    table_[find_slot(str, hash)] = id;
+    return id;
+}
+
+inline bool string_dictionary::find(string_view str, id_type& id) const noexcept {
+    if (table_.empty())
+        return false;
+    const std::size_t slot = find_slot(str, util::hash_bytes(str.data(), str.length()));
+    if (!table_[slot])
+        return false;
+    id = table_[slot];
+    return true;
+}
+
+inline void string_dictionary::clear() noexcept {
+    data_.clear();
+    offsets_.resize(2);
+    table_.clear();
+}
+
+inline std::size_t string_dictionary::find_slot(string_view str, std::uint64_t hash) const noexcept {
+    // linear probing; the table size is a power of two
+    const std::size_t mask = table_.size() - 1;
+    for (std::size_t slot = static_cast<std::size_t>(hash) & mask;; slot = (slot + 1) & mask) {
+        const id_type id = table_[slot];
+        if (!id || value(id) == str)
+            return slot;
+    }
+}
+
+inline void string_dictionary::grow_table() {
+    std::vector<id_type> table(table_.empty() ? 16 : table_.size() * 2, 0);
+    const std::size_t mask = table.size() - 1;
+    for (id_type id = 1; id < size(); ++id) {
+        const string_view str = value(id);
+        std::size_t slot = static_cast<std::size_t>(util::hash_bytes(str.data(), str.length())) & mask;
+        while (table[slot])
+            slot = (slot + 1) & mask;
+        table[slot] = id;
+    }
+    table_.swap(table);
+}
+
+} // namespace detail
+
+
+/// @brief Columnar table of parsed URLs
+///
+/// Stores URL's scheme, host, port, path, query and fragment in separate
+/// columns. Each column is dictionary encoded: it stores a 32-bit value id
+/// per row, and each distinct value once in the column's dictionary. So a
+/// column can be scanned (for example, to group rows by host, or to filter
+/// them by path) without touching the other columns.
+///
+/// The value id 0 (url_table::null_id) is reserved for the null value. In
+/// the scheme column, ids of special schemes are fixed and do not depend on
+/// the order in which URLs were added: use url_table::scheme_id to get them.
+///
+/// The username and password are not stored.
+class url_table {
+public:
+    /// Value id type
+    using value_id = std::uint32_t;
+
+    /// @brief Column types
+    enum ColumnType {
+        SCHEME = 0,
+        HOST,
+        PORT,
+        PATH,
+        QUERY,
+        FRAGMENT,
+        COLUMN_COUNT
+    };
+
+    /// Value id of the null value
+    enum : value_id { null_id = 0 };
+
+    /// @brief Dictionary encoded column
+    class column {
+    public:
+        /// @return number of rows
+        std::size_t size() const noexcept { return ids_.size(); }
+
+        /// @param[in] row row index
+        /// @return value id in the row
+        value_id id(std::size_t row) const noexcept { return ids_[row]; }
+
+        /// @return value ids of all rows
+        const std::vector<value_id>& ids() const noexcept { return ids_; }
+
+        /// @return number of distinct values, including the null value
+        std::size_t dictionary_size() const noexcept { return dict_.size(); }
+
+        /// @brief Gets value by its id
+        ///
+        /// The returned string view is valid until the next row is appended.
+        ///
+        /// @param[in] id value id
+        /// @return value, or empty string for the null value
+        string_view value(value_id id) const noexcept { return dict_.value(id); }
+
+        /// @param[in] row row index
+        /// @return value in the row, or empty string if it is null
+        string_view value_at(std::size_t row) const noexcept { return dict_.value(ids_[row]); }
+
+        /// @param[in] row row index
+        /// @return `true` if value in the row is null
+        bool is_null(std::size_t row) const noexcept { return ids_[row] == null_id; }
+
+        /// @brief Finds value's id
+        /// @param[in]  value value to find
+        /// @param[out] id    value id
+        /// @return `true` if value is found
+        bool find(string_view value, value_id& id) const noexcept { return dict_.find(value, id); }
+
+    private:
+        friend class url_table;
+
+        std::vector<value_id> ids_;
+        detail::string_dictionary dict_;
+    };
+
+    /// @brief Default constructor
+    url_table();
+
+    /// @brief Parses URL string and appends it to the table
+    ///
+    /// If parsing fails, the table is not changed.
+    ///
+    /// @param[in] str_url URL string to parse
+    /// @param[in] pbase   pointer to base URL, may be `nullptr`
+    /// @return error code (@a validation_errc::ok on success)
+    template <class T, enable_if_str_arg_t<T> = 0>
+    validation_errc append(T&& str_url, const url* pbase = nullptr);
+
+    /// @brief Appends URL to the table
+    ///
+    /// @param[in] u URL to append
+    void append(const url& u);
+
+    /// @return number of rows
+    std::size_t size() const noexcept { return columns_[SCHEME].size(); }
+
+    /// @return `true` if table has no rows
+    bool empty() const noexcept { return size() == 0; }
+
+    /// @brief Reserves space for the rows
+    /// @param[in] count number of rows to reserve space for
+    void reserve(std::size_t count);
+
+    /// @brief Removes all rows
+    void clear();
+
+    /// @param[in] t column type
+    /// @return column
+    const column& get_column(ColumnType t) const noexcept { return columns_[t]; }
+
+    /// @brief Gets value in the table cell
+    /// @param[in] row row index
+    /// @param[in] t   column type
+    /// @return value, or empty string if it is null
+    string_view get(std::size_t row, ColumnType t) const noexcept {
+        return columns_[t].value_at(row);
+    }
+
+    /// @brief Gets scheme id
+    /// @param[in]  scheme scheme to find
+    /// @param[out] id     scheme id
+    /// @return `true` if scheme was found
+    bool scheme_id(string_view scheme, value_id& id) const noexcept {
+        return columns_[SCHEME].find(scheme, id);
+    }
+
+private:
+    void append_value(ColumnType t, const url& u, url::PartType pt);
+
+private:
+    column columns_[COLUMN_COUNT];
+    // used by append(str_url, pbase)
+    url url_;
+};
+
+
+// url_table class
+
+inline url_table::url_table() {
+    clear();
+}
+
+template <class T, enable_if_str_arg_t<T>>
+inline validation_errc url_table::append(T&& str_url, const url* pbase) {
+    const validation_errc res = url_.parse(std::forward<T>(str_url), pbase);
+    if (res == validation_errc::ok)
+        append(url_);
+    return res;
+}
+
+inline void url_table::append(const url& u) {
+    // the special schemes were added to the dictionary in the
+    // url::kSchemes order
+    column& col_scheme = columns_[SCHEME];
+    col_scheme.ids_.push_back(u.scheme_inf_
+        ? static_cast<value_id>(u.scheme_inf_ - url::kSchemes) + 1
+        : col_scheme.dict_.intern(u.get_part_view(url::SCHEME)));
+
+    append_value(HOST, u, url::HOST);
+    append_value(PORT, u, url::PORT);
+    append_value(PATH, u, url::PATH);
+    append_value(QUERY, u, url::QUERY);
+    append_value(FRAGMENT, u, url::FRAGMENT);
+}
+
+inline void url_table::append_value(ColumnType t, const url& u, url::PartType pt) {
+    column& col = columns_[t];
+    col.ids_.push_back(u.is_null(pt) ? value_id{ null_id } : col.dict_.intern(u.get_part_view(pt)));
+}
+
+inline void url_table::reserve(std::size_t count) {
+    for (auto& col : columns_)
+        col.ids_.reserve(count);
+}
+
+inline void url_table::clear() {
+    for (auto& col : columns_) {
+        col.ids_.clear();
+        col.dict_.clear();
+    }
+    // fixed ids of the special schemes
+    for (std::size_t ind = 0; ind < url::kSchemeCount; ++ind)
+        columns_[SCHEME].dict_.intern(url::kSchemes[ind].scheme);
+}
+
+
+} // namespace upa
+
+#endif // UPA_URL_TABLE_H
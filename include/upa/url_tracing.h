@@ -0,0 +1,189 @@
+// Copyright 2016-2024 Rimas Misevičius
+// Distributed under the BSD-style license that can be
+// found in the LICENSE file.
+//
+
+#ifndef UPA_URL_TRACING_H
+#define UPA_URL_TRACING_H
+
+// Opt-in tracing of URL library hot paths
+//
+// If the UPA_URL_TRACING macro is defined (the library and all its users must
+// be compiled with it), then the URL parser, host parser, domain to ASCII
+// conversion, search parameters parser and URL setters mark their scopes:
+// the tracer set by upa::tracing::set_tracer gets begin and end events of each
+// scope. Otherwise the UPA_TRACE_SCOPE macro expands to nothing.
+
+#ifdef UPA_URL_TRACING
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+namespace upa {
+namespace tracing {
+
+/// @brief Tracer interface
+///
+/// Its member functions are called concurrently from all threads that use the
+/// URL library, so implementations must be thread safe. They should not throw:
+/// the end function is called from a destructor.
+class tracer {
+public:
+    virtual ~tracer() = default;
+
+    /// @brief Called on entry into the scope
+    /// @param[in] name scope name, a string literal
+    virtual void begin(const char* name) = 0;
+
+    /// @brief Called on exit from the scope
+    /// @param[in] name scope name, the same as in begin
+    virtual void end(const char* name) = 0;
+};
+
+namespace detail {
+
+inline std::atomic<tracer*>& active_tracer() noexcept {
+    static std::atomic<tracer*> ptr{ nullptr };
+    return ptr;
+}
+
+} // namespace detail
+
+/// @brief Sets the tracer
+///
+/// The tracer must outlive all scopes started while it is set. Pass `nullptr`
+/// to stop tracing.
+///
+/// @param[in] tr pointer to tracer or `nullptr`
+inline void set_tracer(tracer* tr) noexcept {
+    detail::active_tracer().store(tr, std::memory_order_release);
+}
+
+/// @return current tracer or `nullptr`
+inline tracer* get_tracer() noexcept {
+    return detail::active_tracer().load(std::memory_order_acquire);
+}
+
+/// @brief RAII object reporting scope begin and end to the current tracer
+class scope {
+public:
+    explicit scope(const char* name)
+        : tracer_(get_tracer())
+        , name_(name)
+    {
+        if (tracer_)
+            tracer_->begin(name_);
+    }
+
+    ~scope() {
+        if (tracer_)
+            tracer_->end(name_);
+    }
+
+    scope(const scope&) = delete;
+    scope& operator=(const scope&) = delete;
+
+private:
+    tracer* tracer_;
+    const char* name_;
+};
+
+/// @brief Tracer collecting events in the Chrome trace event format
+///
+/// The collected events can be written as JSON, which can be loaded into
+/// the Perfetto UI (https://ui.perfetto.dev/) or chrome://tracing.
+class chrome_trace_writer : public tracer {
+public:
+    chrome_trace_writer()
+        : start_(clock::now())
+    {}
+
+    void begin(const char* name) override {
+        add_event(name, 'B');
+    }
+
+    void end(const char* name) override {
+        add_event(name, 'E');
+    }
+
+    /// @brief Writes collected events as JSON
+    /// @param[out] out output stream
+    void write(std::ostream& out) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        out << "{\"traceEvents\":[";
+        const char* sep = "\n";
+        for (const auto& ev : events_) {
+            // timestamp in microseconds with nanosecond precision
+            const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(ev.time - start_).count();
+            const char frac[] = {
+                '.',
+                static_cast<char>('0' + ns / 100 % 10),
+                static_cast<char>('0' + ns / 10 % 10),
+                static_cast<char>('0' + ns % 10),
+                0 };
+            out << sep << "{\"name\":\"" << ev.name << "\",\"cat\":\"upa\",\"ph\":\"" << ev.phase
+                << "\",\"ts\":" << ns / 1000 << frac << ",\"pid\":1,\"tid\":" << ev.tid << '}';
+            sep = ",\n";
+        }
+        out << "\n],\"displayTimeUnit\":\"ns\"}\n";
+    }
+
+    /// @return number of collected events
+    std::size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return events_.size();
+    }
+
+    /// @brief Removes all collected events
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        events_.clear();
+    }
+
+private:
+    using clock = std::chrono::steady_clock;
+
+    struct event {
+        const char* name;
+        clock::time_point time;
+        std::uint32_t tid;
+        char phase;
+    };
+
+    static std::uint32_t thread_index() noexcept {
+        static std::atomic<std::uint32_t> next{ 1 };
+        static thread_local const std::uint32_t index = next.fetch_add(1, std::memory_order_relaxed);
+        return index;
+    }
+
+    void add_event(const char* name, char phase) {
+        const event ev{ name, clock::now(), thread_index(), phase };
+        std::lock_guard<std::mutex> lock(mutex_);
+        events_.push_back(ev);
+    }
+
+    const clock::time_point start_;
+    mutable std::mutex mutex_;
+    std::vector<event> events_;
+};
+
+} // namespace tracing
+} // namespace upa
+
+# define UPA_TRACE_CONCAT_(a, b) a##b
+# define UPA_TRACE_CONCAT(a, b) UPA_TRACE_CONCAT_(a, b)
+# define UPA_TRACE_SCOPE(name) \
+    const ::upa::tracing::scope UPA_TRACE_CONCAT(upa_trace_scope_, __LINE__)(name)
+
+#else
+
+# define UPA_TRACE_SCOPE(name) ((void)0)
+
+#endif // UPA_URL_TRACING
+
+#endif // UPA_URL_TRACING_H
@@ -42,6 +42,9 @@ class url_utf {
     // Invalid utf-8 bytes sequences are replaced with 0xFFFD character.
     static void check_fix_utf8(std::string& str);
 
+    // Returns true if [first, last) is valid utf-8 byte sequence.
+    static bool is_valid_utf8(const char* first, const char* last) noexcept;
+
     static int compare_by_code_units(const char* first1, const char* last1, const char* first2, const char* last2) noexcept;
 protected:
     // low level
@@ -9,6 +9,8 @@
 #include "config.h"
 #include <algorithm>
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <iterator>  // std::back_inserter
 #include <limits>
 #include <stdexcept>
@@ -180,6 +182,98 @@ UPA_CONSTEXPR_17 bool has_xn_label(const CharT* first, const CharT* last) {
     return false;
 }
 
+// Hashing
+
+// Non-cryptographic 64-bit hash function. It reads input by 8 byte words and
+// mixes them using multiplications and rotations; the final value is avalanched
+// with the MurmurHash3 fmix64 finalizer.
+// The result does not depend on how the input is split into update() calls.
+class hasher {
+public:
+#if defined(__clang__)
+    __attribute__((no_sanitize("unsigned-integer-overflow")))
+#endif
+    void update(const char* data, std::size_t len) noexcept {
+        if (len == 0)
+            return;
+        length_ += len;
+        if (tail_len_) {
+            const std::size_t count = std::min(len, sizeof(tail_) - tail_len_);
+            std::memcpy(tail_ + tail_len_, data, count);
+            tail_len_ += count;
+            data += count;
+            len -= count;
+            if (tail_len_ < sizeof(tail_))
+                return;
+            mix(read_word(tail_));
+            tail_len_ = 0;
+        }
+        for (; len >= sizeof(std::uint64_t); len -= sizeof(std::uint64_t), data += sizeof(std::uint64_t))
+            mix(read_word(data));
+        if (len) {
+            std::memcpy(tail_, data, len);
+            tail_len_ = len;
+        }
+    }
+
+#if defined(__clang__)
+    __attribute__((no_sanitize("unsigned-integer-overflow")))
+#endif
+    std::uint64_t result() const noexcept {
+        std::uint64_t h = h_;
+        if (tail_len_) {
+            char word[sizeof(std::uint64_t)] = {};
+            std::memcpy(word, tail_, tail_len_);
+            h = mix(h, read_word(word));
+        }
+        h ^= static_cast<std::uint64_t>(length_);
+        // fmix64
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+private:
+    static std::uint64_t read_word(const char* ptr) noexcept {
+        std::uint64_t word; // NOLINT(cppcoreguidelines-init-variables)
+        std::memcpy(&word, ptr, sizeof(word));
+        return word;
+    }
+
+    static constexpr std::uint64_t rotl(std::uint64_t x, int r) noexcept {
+        return (x << r) | (x >> (64 - r));
+    }
+
+#if defined(__clang__)
+    __attribute__((no_sanitize("unsigned-integer-overflow")))
+#endif
+    static std::uint64_t mix(std::uint64_t h, std::uint64_t k) noexcept {
+        k *= 0x87c37b91114253d5ULL;
+        k = rotl(k, 31);
+        k *= 0x4cf5ad432745937fULL;
+        h ^= k;
+        return rotl(h, 27) * 5 + 0x52dce729;
+    }
+
+    void mix(std::uint64_t k) noexcept {
+        h_ = mix(h_, k);
+    }
+
+    std::uint64_t h_ = 0x9e3779b97f4a7c15ULL;
+    std::size_t length_ = 0;
+    std::size_t tail_len_ = 0;
+    char tail_[sizeof(std::uint64_t)] = {};
+};
+
+inline std::uint64_t hash_bytes(const char* data, std::size_t len) noexcept {
+    hasher h;
+    h.update(data, len);
+    return h.result();
+}
+
 
 } // namespace util
 } // namespace upa
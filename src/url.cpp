@@ -45,7 +45,7 @@ const unsigned url::kPartFlagMask[url::PART_COUNT] = {
 };
 
 // MUST be sorted by length
-const url::scheme_info url::kSchemes[] = {
+const url::scheme_info url::kSchemes[url::kSchemeCount] = {
     // scheme,         port, is_special, is_file, is_http, is_ws
     { { "ws", 2 },       80,          1,       0,       0,     1 },
     { { "wss", 3 },     443,          1,       0,       0,     1 },
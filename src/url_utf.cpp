@@ -67,6 +67,19 @@ void url_utf::check_fix_utf8(std::string& str) {
     }
 }
 
+bool url_utf::is_valid_utf8(const char* first, const char* last) noexcept {
+    uint32_t code_point; // NOLINT(cppcoreguidelines-init-variables)
+    while (first != last) {
+        if (static_cast<unsigned char>(*first) < 0x80) {
+            ++first;
+            continue;
+        }
+        if (!read_code_point(first, last, code_point))
+            return false;
+    }
+    return true;
+}
+
 int url_utf::compare_by_code_units(const char* first1, const char* last1, const char* first2, const char* last2) noexcept {
     const auto* it1 = first1;
     const auto* it2 = first2;
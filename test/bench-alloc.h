@@ -0,0 +1,126 @@
+// Copyright 2024 Rimas Misevičius
+// Distributed under the BSD-style license that can be
+// found in the LICENSE file.
+//
+
+#ifndef UPA_BENCH_ALLOC_H
+#define UPA_BENCH_ALLOC_H
+
+// Counts heap allocations of the current thread by replacing the global
+// operator new and operator delete. The replacement must be compiled into
+// exactly one translation unit of an executable: define
+// UPA_BENCH_ALLOC_IMPLEMENT before including this file there.
+//
+// All allocations made through std::allocator are counted, including the
+// ones of std::string and of upa::simple_buffer when it outgrows its inline
+// storage. Over-aligned allocations (C++17 std::align_val_t overloads) are
+// not replaced and not counted.
+
+#include <cstddef>
+#include <cstdint>
+
+namespace bench {
+
+struct alloc_stats {
+    uint64_t count;
+    uint64_t bytes;
+};
+
+// Returns allocation counters of the current thread
+alloc_stats alloc_snapshot() noexcept;
+
+// Returns allocations made by the current thread while running fn
+template <class Fn>
+inline alloc_stats count_allocs(Fn&& fn) {
+    const alloc_stats before = alloc_snapshot();
+    fn();
+    const alloc_stats after = alloc_snapshot();
+    return { after.count - before.count, after.bytes - before.bytes };
+}
+
+} // namespace bench
+
+#ifdef UPA_BENCH_ALLOC_IMPLEMENT
+
+#include <cstdlib>
+#include <new>
+
+namespace bench {
+namespace {
+
+thread_local uint64_t alloc_count = 0;
+thread_local uint64_t alloc_bytes = 0;
+
+void* counted_alloc(std::size_t size) noexcept {
+    ++alloc_count;
+    alloc_bytes += size;
+    return std::malloc(size ? size : 1);
+}
+
+// GCC warns when the inlined replacement operators are used together
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+# pragma GCC diagnostic push
+# pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void counted_free(void* ptr) noexcept {
+    std::free(ptr);
+}
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+# pragma GCC diagnostic pop
+#endif
+
+} // namespace
+
+alloc_stats alloc_snapshot() noexcept {
+    return { alloc_count, alloc_bytes };
+}
+
+} // namespace bench
+
+void* operator new(std::size_t size) {
+    if (void* ptr = bench::counted_alloc(size))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    if (void* ptr = bench::counted_alloc(size))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    return bench::counted_alloc(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return bench::counted_alloc(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    bench::counted_free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    bench::counted_free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    bench::counted_free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept {
+    bench::counted_free(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+    bench::counted_free(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+    bench::counted_free(ptr);
+}
+
+#endif // UPA_BENCH_ALLOC_IMPLEMENT
+
+#endif // UPA_BENCH_ALLOC_H
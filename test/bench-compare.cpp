@@ -0,0 +1,321 @@
+// Copyright 2024 Rimas Misevičius
+// Distributed under the BSD-style license that can be
+// found in the LICENSE file.
+//
+
+// Runs the benchmark suite several times, saves the results as JSON
+// baseline, and compares new results with a saved baseline.
+
+#define ANKERL_NANOBENCH_IMPLEMENT
+#include "bench-components.h"
+#include "picojson/picojson.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// -----------------------------------------------------------------------------
+// Results: benchmark name -> ns/op of each run
+
+using bench_results = std::map<std::string, std::vector<double>>;
+
+class collecting_runner {
+public:
+    collecting_runner(bench_results& results, uint64_t min_iters)
+        : results_(results)
+    {
+        bench_.unit("op").minEpochIterations(min_iters).output(nullptr);
+    }
+
+    template <class Fn>
+    void operator()(const char* suite, const char* name, std::size_t, Fn&& fn) {
+        const std::string full_name = std::string(suite) + ": " + name;
+        bench_.run(full_name, std::forward<Fn>(fn));
+        const auto& res = bench_.results().back();
+        results_[full_name].push_back(
+            res.median(ankerl::nanobench::Result::Measure::elapsed) * 1e9);
+    }
+
+private:
+    bench_results& results_;
+    ankerl::nanobench::Bench bench_;
+};
+
+int run_suite(unsigned runs, uint64_t min_iters, const std::string& corpus_file, bench_results& results) {
+    std::vector<std::string> corpus;
+    std::size_t corpus_bytes = 0;
+    if (!corpus_file.empty()) {
+        std::ifstream finp(corpus_file);
+        if (!finp.is_open()) {
+            std::cerr << "Failed to open " << corpus_file << '\n';
+            return 2;
+        }
+        std::string line;
+        while (std::getline(finp, line)) {
+            corpus_bytes += line.length();
+            corpus.push_back(line);
+        }
+    }
+
+    for (unsigned run = 0; run < runs; ++run) {
+        std::cerr << "Run " << (run + 1) << " of " << runs << '\n';
+        collecting_runner runner(results, min_iters);
+        bench::run_components(runner);
+        if (!corpus.empty()) {
+            runner("url::parse", "corpus", corpus_bytes, [&] {
+                upa::url url;
+                for (const auto& str_url : corpus) {
+                    url.parse(str_url);
+                    ankerl::nanobench::doNotOptimizeAway(url);
+                }
+            });
+        }
+    }
+    return 0;
+}
+
+// -----------------------------------------------------------------------------
+// Baseline files
+
+void write_results(std::ostream& out, const bench_results& results) {
+    out << "{\n  \"version\": 1,\n  \"unit\": \"ns/op\",\n  \"benchmarks\": {";
+    bool first = true;
+    out << std::setprecision(6);
+    for (const auto& item : results) {
+        out << (first ? "\n" : ",\n") << "    \"" << item.first << "\": [";
+        first = false;
+        for (std::size_t i = 0; i < item.second.size(); ++i)
+            out << (i ? ", " : "") << item.second[i];
+        out << ']';
+    }
+    out << "\n  }\n}\n";
+}
+
+bool read_results(const char* file_name, bench_results& results) {
+    std::ifstream finp(file_name, std::ios_base::in | std::ios_base::binary);
+    if (!finp.is_open()) {
+        std::cerr << "Failed to open " << file_name << '\n';
+        return false;
+    }
+    picojson::value root;
+    const std::string err = picojson::parse(root, finp);
+    if (!err.empty() || !root.is<picojson::object>() || !root.contains("benchmarks") ||
+        !root.get("benchmarks").is<picojson::object>()) {
+        std::cerr << "Invalid baseline file: " << file_name << '\n';
+        return false;
+    }
+    for (const auto& item : root.get("benchmarks").get<picojson::object>()) {
+        const auto is_number = [](const picojson::value& val) { return val.is<double>(); };
+        if (!item.second.is<picojson::array>() ||
+            !std::all_of(item.second.get<picojson::array>().begin(),
+                item.second.get<picojson::array>().end(), is_number)) {
+            std::cerr << "Invalid baseline file: " << file_name << '\n';
+            return false;
+        }
+        auto& samples = results[item.first];
+        for (const auto& val : item.second.get<picojson::array>())
+            samples.push_back(val.get<double>());
+    }
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+// Statistics
+
+double median_of_sorted(const std::vector<double>& v) {
+    const std::size_t n = v.size();
+    return n % 2 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2;
+}
+
+struct sample_stats {
+    double median;
+    double mad;     // median absolute deviation
+    double ci_low;  // ~95% confidence interval of the median
+    double ci_high;
+};
+
+// The confidence interval is distribution free: it is bounded by the order
+// statistics of ranks n/2 -+ 1.96 * sqrt(n) / 2
+sample_stats get_stats(std::vector<double> v) {
+    std::sort(v.begin(), v.end());
+    sample_stats st;
+    st.median = median_of_sorted(v);
+
+    std::vector<double> dev;
+    dev.reserve(v.size());
+    for (const double x : v)
+        dev.push_back(std::fabs(x - st.median));
+    std::sort(dev.begin(), dev.end());
+    st.mad = median_of_sorted(dev);
+
+    const double n = static_cast<double>(v.size());
+    const double half_width = 1.96 * std::sqrt(n) / 2;
+    const auto low = static_cast<std::ptrdiff_t>(std::floor(n / 2 - half_width));
+    const auto high = static_cast<std::ptrdiff_t>(std::ceil(n / 2 + half_width)) - 1;
+    st.ci_low = v[static_cast<std::size_t>(std::max<std::ptrdiff_t>(low, 0))];
+    st.ci_high = v[static_cast<std::size_t>(std::min<std::ptrdiff_t>(high, v.size() - 1))];
+    return st;
+}
+
+// Returns number of regressions
+std::size_t compare(const bench_results& baseline, const bench_results& current, double threshold) {
+    std::size_t regressions = 0;
+
+    std::cout << "\n|  base ns/op |   new ns/op |  change |    new MAD |     new 95% CI        | status     | benchmark\n"
+                   "|------------:|------------:|--------:|-----------:|:----------------------|:-----------|:----------\n";
+    std::cout << std::fixed << std::setprecision(2);
+    for (const auto& item : current) {
+        const auto it = baseline.find(item.first);
+        if (it == baseline.end() || it->second.empty() || item.second.empty()) {
+            std::cout << "| " << std::setw(11) << "-" << " | " << std::setw(11) << "-"
+                      << " |         |            |                       | new        | " << item.first << '\n';
+            continue;
+        }
+        const sample_stats base = get_stats(it->second);
+        const sample_stats cur = get_stats(item.second);
+        const double change = (cur.median - base.median) / base.median * 100;
+
+        // a change is significant if confidence intervals do not overlap
+        const char* status = "ok";
+        if (change > threshold && cur.ci_low > base.ci_high) {
+            status = "REGRESSION";
+            ++regressions;
+        } else if (change < -threshold && cur.ci_high < base.ci_low) {
+            status = "improved";
+        } else if (std::fabs(change) > threshold) {
+            status = "noise";
+        }
+
+        std::ostringstream ci;
+        ci << std::fixed << std::setprecision(2) << '[' << cur.ci_low << ", " << cur.ci_high << ']';
+        std::cout << "| " << std::setw(11) << base.median
+                  << " | " << std::setw(11) << cur.median
+                  << " | " << std::setw(6) << std::showpos << change << std::noshowpos << '%'
+                  << " | " << std::setw(10) << cur.mad
+                  << " | " << std::left << std::setw(21) << ci.str()
+                  << " | " << std::setw(10) << status << std::right
+                  << " | " << item.first << '\n';
+    }
+    for (const auto& item : baseline) {
+        if (current.find(item.first) == current.end()) {
+            std::cout << "| " << std::setw(11);
+            if (item.second.empty())
+                std::cout << "-";
+            else
+                std::cout << get_stats(item.second).median;
+            std::cout << " | " << std::setw(11) << "-"
+                      << " |         |            |                       | missing    | " << item.first << '\n';
+        }
+    }
+
+    std::cout << '\n' << regressions << " regression(s) over " << threshold << "% threshold\n";
+    return regressions;
+}
+
+// -----------------------------------------------------------------------------
+
+void usage() {
+    std::cerr <<
+        "Usage:\n"
+        "  bench-compare run [<options>]\n"
+        "      runs benchmarks and writes results (baseline) as JSON\n"
+        "  bench-compare compare <baseline.json> [<options>]\n"
+        "      runs benchmarks and compares results with the baseline\n"
+        "  bench-compare compare <baseline.json> <results.json> [--threshold=P]\n"
+        "      compares two saved results\n"
+        "Options:\n"
+        "  --runs=N         number of suite runs (10)\n"
+        "  --min-iters=N    minimum iterations per epoch (1000)\n"
+        "  --corpus=FILE    also benchmark url::parse of URLs in FILE (URL in each line)\n"
+        "  --output=FILE    write results to FILE (run: stdout)\n"
+        "  --threshold=P    regression threshold in percent (5)\n"
+        "Exit status of compare is 3 if any benchmark regressed.\n";
+}
+
+int main(int argc, const char* argv[])
+{
+    unsigned runs = 10;
+    uint64_t min_iters = 1000;
+    double threshold = 5;
+    std::string corpus_file;
+    std::string output;
+    std::vector<const char*> args;
+
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        if (std::strncmp(arg, "--runs=", 7) == 0) {
+            runs = static_cast<unsigned>(std::strtoul(arg + 7, nullptr, 10));
+        } else if (std::strncmp(arg, "--min-iters=", 12) == 0) {
+            min_iters = std::strtoull(arg + 12, nullptr, 10);
+        } else if (std::strncmp(arg, "--corpus=", 9) == 0) {
+            corpus_file = arg + 9;
+        } else if (std::strncmp(arg, "--output=", 9) == 0) {
+            output = arg + 9;
+        } else if (std::strncmp(arg, "--threshold=", 12) == 0) {
+            threshold = std::strtod(arg + 12, nullptr);
+        } else if (std::strncmp(arg, "--", 2) == 0) {
+            usage();
+            return 1;
+        } else {
+            args.push_back(arg);
+        }
+    }
+    if (args.empty() || runs == 0 || min_iters == 0 || threshold < 0) {
+        usage();
+        return 1;
+    }
+
+    const std::string command = args[0];
+    if (command == "run" && args.size() == 1) {
+        bench_results results;
+        const int err = run_suite(runs, min_iters, corpus_file, results);
+        if (err)
+            return err;
+        if (output.empty()) {
+            write_results(std::cout, results);
+        } else {
+            std::ofstream fout(output, std::ios_base::out | std::ios_base::binary);
+            write_results(fout, results);
+            if (!fout) {
+                std::cerr << "Failed to write " << output << '\n';
+                return 2;
+            }
+        }
+        return 0;
+    }
+
+    if (command == "compare" && (args.size() == 2 || args.size() == 3)) {
+        bench_results baseline, current;
+        if (!read_results(args[1], baseline))
+            return 2;
+        if (args.size() == 3) {
+            if (!read_results(args[2], current))
+                return 2;
+        } else {
+            const int err = run_suite(runs, min_iters, corpus_file, current);
+            if (err)
+                return err;
+            if (!output.empty()) {
+                std::ofstream fout(output, std::ios_base::out | std::ios_base::binary);
+                write_results(fout, current);
+                if (!fout) {
+                    std::cerr << "Failed to write " << output << '\n';
+                    return 2;
+                }
+            }
+        }
+        return compare(baseline, current, threshold) ? 3 : 0;
+    }
+
+    usage();
+    return 1;
+}
@@ -0,0 +1,100 @@
+// Copyright 2024 Rimas Misevičius
+// Distributed under the BSD-style license that can be
+// found in the LICENSE file.
+//
+
+#define ANKERL_NANOBENCH_IMPLEMENT
+#include "bench-components.h"
+#define UPA_BENCH_ALLOC_IMPLEMENT
+#include "bench-alloc.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// -----------------------------------------------------------------------------
+// Runs each component case with nanobench, and prints ns/op, bytes/s, and
+// heap allocations per operation
+
+class nanobench_runner {
+public:
+    nanobench_runner(std::string filter, uint64_t min_iters)
+        : filter_(std::move(filter))
+    {
+        bench_.unit("op").minEpochIterations(min_iters);
+    }
+
+    template <class Fn>
+    void operator()(const char* suite, const char* name, std::size_t bytes, Fn fn) {
+        const std::string full_name = std::string(suite) + ": " + name;
+        if (full_name.find(filter_) == std::string::npos)
+            return;
+
+        bench_.title(suite).run(full_name, fn);
+        // one more operation after the warmed up runs
+        const bench::alloc_stats allocs = bench::count_allocs(fn);
+
+        const auto& res = bench_.results().back();
+        const double sec_per_op = res.median(ankerl::nanobench::Result::Measure::elapsed);
+        rows_.push_back({ full_name, sec_per_op * 1e9, sec_per_op > 0 ? bytes / sec_per_op : 0.0, allocs });
+    }
+
+    void print_summary(std::ostream& os) const {
+        os << "\n|        ns/op |         MB/s | allocs/op | bytes/op | benchmark\n"
+              "|-------------:|-------------:|----------:|---------:|:----------\n";
+        for (const auto& row : rows_) {
+            os << "| " << std::setw(12) << std::fixed << std::setprecision(2) << row.ns_per_op
+               << " | " << std::setw(12) << row.bytes_per_sec / 1e6
+               << " | " << std::setw(9) << row.allocs.count
+               << " | " << std::setw(8) << row.allocs.bytes
+               << " | " << row.name << '\n';
+        }
+    }
+
+private:
+    struct row {
+        std::string name;
+        double ns_per_op;
+        double bytes_per_sec;
+        bench::alloc_stats allocs;
+    };
+
+    std::string filter_;
+    ankerl::nanobench::Bench bench_;
+    std::vector<row> rows_;
+};
+
+// -----------------------------------------------------------------------------
+
+uint64_t get_positive_or_default(const char* str, uint64_t def)
+{
+    const uint64_t res = std::strtoull(str, nullptr, 10);
+    if (res > 0)
+        return res;
+    return def;
+}
+
+int main(int argc, const char* argv[])
+{
+    constexpr uint64_t min_iters_def = 1000;
+
+    if (argc > 1 && (std::string(argv[1]) == "-h" || std::string(argv[1]) == "--help")) {
+        std::cerr << "Usage: bench-components [<filter> [<min iterations>]]\n"
+                     "Runs benchmarks whose \"suite: case\" name contains <filter>.\n";
+        return 1;
+    }
+
+    const std::string filter = argc > 1 ? argv[1] : "";
+    const uint64_t min_iters = argc > 2
+        ? get_positive_or_default(argv[2], min_iters_def)
+        : min_iters_def;
+
+    nanobench_runner runner(filter, min_iters);
+    bench::run_components(runner);
+    runner.print_summary(std::cout);
+
+    return 0;
+}
@@ -1,4 +1,4 @@
-// Copyright 2023 Rimas Misevičius
+// Copyright 2023-2024 Rimas Misevičius
 // Distributed under the BSD-style license that can be
 // found in the LICENSE file.
 //
@@ -6,64 +6,114 @@
 #include "upa/url.h"
 #include "picojson_util.h"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <cstdlib>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <memory>
+#include <sstream>
 #include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+# include <pthread.h>
+# include <sched.h>
+#endif
 
 #define ANKERL_NANOBENCH_IMPLEMENT
 #include "ankerl/nanobench.h"
+#define UPA_BENCH_ALLOC_IMPLEMENT
+#include "bench-alloc.h"
 
 // -----------------------------------------------------------------------------
-// Read samples from text file (URL in each line) and benchmark
+// URL samples
+
+// Input classes to report separately
+enum input_class : std::size_t {
+    CLASS_ASCII,    // valid absolute URL, ASCII-only input without IDN host
+    CLASS_IDN,      // valid absolute URL, non-ASCII input or IDN host
+    CLASS_RELATIVE, // valid URL relative to a base
+    CLASS_INVALID,  // invalid URL
+    CLASS_COUNT
+};
+
+const char* const input_class_names[CLASS_COUNT] = {
+    "ascii", "idn", "relative", "invalid"
+};
+
+struct url_sample {
+    std::string input;
+    const upa::url* base;
+};
+
+struct url_samples {
+    std::vector<url_sample> all;
+    std::array<std::vector<url_sample>, CLASS_COUNT> by_class;
+    std::vector<std::unique_ptr<upa::url>> bases;
+
+    void add(std::string input, const std::string& base_str);
+};
+
+bool is_ascii(const std::string& str) {
+    for (const char c : str) {
+        if (static_cast<unsigned char>(c) >= 0x80)
+            return false;
+    }
+    return true;
+}
 
-int benchmark_txt(const char* file_name, uint64_t min_iters) {
-    std::vector<std::string> url_strings;
+void url_samples::add(std::string input, const std::string& base_str) {
+    const upa::url* base = nullptr;
+    if (!base_str.empty()) {
+        auto base_url = std::make_unique<upa::url>();
+        if (!upa::success(base_url->parse(base_str)))
+            return; // invalid base
+        base = base_url.get();
+        bases.push_back(std::move(base_url));
+    }
 
-    // Load URL samples
-    std::cout << "Load URL samples from: " << file_name << '\n';
+    upa::url url;
+    input_class ic;
+    if (!upa::success(url.parse(input, base)))
+        ic = CLASS_INVALID;
+    else if (base)
+        ic = CLASS_RELATIVE;
+    else if (!is_ascii(input) || url.hostname().find("xn--") != std::string::npos)
+        ic = CLASS_IDN;
+    else
+        ic = CLASS_ASCII;
+
+    by_class[ic].push_back(url_sample{ input, base });
+    all.push_back(url_sample{ std::move(input), base });
+}
+
+// Reads samples from text file (URL in each line)
+
+int load_txt(const char* file_name, url_samples& samples, std::ostream& log) {
+    log << "Load URL samples from: " << file_name << '\n';
     std::ifstream finp(file_name);
     if (!finp.is_open()) {
-        std::cout << "Failed to open " << file_name << '\n';
+        std::cerr << "Failed to open " << file_name << '\n';
         return 2;
     }
 
     std::string line;
     while (std::getline(finp, line))
-        url_strings.push_back(line);
-
-    // Run benchmark
-
-    ankerl::nanobench::Bench().minEpochIterations(min_iters).run("Upa url::parse", [&] {
-        upa::url url;
-
-        for (const auto& str_url : url_strings) {
-            url.parse(str_url);
-
-            ankerl::nanobench::doNotOptimizeAway(url);
-        }
-    });
-
-    ankerl::nanobench::Bench().minEpochIterations(min_iters).run("Upa url::can_parse", [&] {
-        for (const auto& str_url : url_strings) {
-            bool ok = upa::url::can_parse(str_url);
-
-            ankerl::nanobench::doNotOptimizeAway(ok);
-        }
-    });
-
+        samples.add(line, {});
     return 0;
 }
 
-// -----------------------------------------------------------------------------
-// Read samples from urltestdata.json and benchmark
-
-int benchmark_wpt(const char* file_name, uint64_t min_iters) {
-    std::vector<std::pair<std::string, std::string>> url_samples;
+// Reads samples from urltestdata.json
 
-    // Load URL samples
+int load_wpt(const char* file_name, url_samples& samples, std::ostream& log) {
     json_util::root_array_context context{ [&](const picojson::value& item) {
         if (item.is<picojson::object>()) {
             try {
@@ -71,51 +121,361 @@ int benchmark_wpt(const char* file_name, uint64_t min_iters) {
                 const auto input_val = obj.at("input");
                 const auto base_val = obj.at("base");
 
-                url_samples.emplace_back(
+                samples.add(
                     input_val.get<std::string>(),
                     base_val.is<picojson::null>() ? std::string{} : base_val.get<std::string>());
             }
             catch (const std::out_of_range& ex) {
-                std::cout << "[ERR:invalid file]: " << ex.what() << std::endl;
+                std::cerr << "[ERR:invalid file]: " << ex.what() << std::endl;
                 return false;
             }
         }
         return true;
     } };
 
-    const int err = json_util::load_file(context, file_name, "Load URL samples from");
-    if (err != 0)
-        return err;
+    return json_util::load_file(context, file_name, "Load URL samples from", log);
+}
 
-    // Run benchmark
+// -----------------------------------------------------------------------------
+// Benchmark results normalized per URL
+
+struct url_result {
+    std::string name;
+    std::string input_class;
+    std::size_t urls;
+    double bytes_per_url;
+    double ns_per_url;
+    // hardware performance counters; negative if not available
+    double cycles_per_url;
+    double instructions_per_url;
+    double branch_misses_per_url;
+    // heap allocations
+    double allocs_per_url;
+    double alloc_bytes_per_url;
+};
+
+class result_table {
+public:
+    void add(const std::string& name, const char* input_class, const std::vector<url_sample>& samples,
+        const ankerl::nanobench::Result& res, const bench::alloc_stats& allocs)
+    {
+        using Measure = ankerl::nanobench::Result::Measure;
+        const auto per_url = [&](Measure m) {
+            return res.has(m) ? res.median(m) : -1.0;
+        };
+
+        std::size_t bytes = 0;
+        for (const auto& sample : samples)
+            bytes += sample.input.length();
+
+        const double urls = static_cast<double>(samples.size());
+        rows_.push_back(url_result{
+            name, input_class, samples.size(),
+            static_cast<double>(bytes) / urls,
+            res.median(Measure::elapsed) * 1e9,
+            per_url(Measure::cpucycles),
+            per_url(Measure::instructions),
+            per_url(Measure::branchmisses),
+            static_cast<double>(allocs.count) / urls,
+            static_cast<double>(allocs.bytes) / urls
+        });
+    }
 
-    ankerl::nanobench::Bench().minEpochIterations(min_iters).run("Upa url::parse", [&] {
-        upa::url url;
-        upa::url url_base;
+    // Adds the multi-threaded throughput result: `urls` URLs of `samples`
+    // parsed in `seconds`; the counters and allocations are not available
+    void add_throughput(const std::string& name, const std::vector<url_sample>& samples,
+        uint64_t urls, double seconds)
+    {
+        std::size_t bytes = 0;
+        for (const auto& sample : samples)
+            bytes += sample.input.length();
+
+        rows_.push_back(url_result{
+            name, "all", samples.size(),
+            static_cast<double>(bytes) / static_cast<double>(samples.size()),
+            seconds * 1e9 / static_cast<double>(urls),
+            -1.0, -1.0, -1.0, -1.0, -1.0
+        });
+    }
 
-        for (const auto& url_strings : url_samples) {
-            upa::url* ptr_base = nullptr;
-            if (!url_strings.second.empty()) {
-                if (!upa::success(url_base.parse(url_strings.second)))
-                    continue; // invalid base
-                ptr_base = &url_base;
-            }
-            url.parse(url_strings.first, ptr_base);
+    void print(std::ostream& os) const {
+        os << "\n|  URLs | bytes/URL |    ns/URL |  cycles/URL |   ins/URL | brmiss/URL | bytes/cycle | allocs/URL | alloc bytes/URL | benchmark\n"
+                "|------:|----------:|----------:|------------:|----------:|-----------:|------------:|-----------:|----------------:|:----------\n";
+        const auto flags = os.flags();
+        const auto precision = os.precision();
+        os << std::fixed;
+        for (const auto& row : rows_) {
+            os << "| " << std::setw(5) << row.urls
+               << " | " << std::setw(9) << std::setprecision(1) << row.bytes_per_url
+               << " | " << std::setw(9) << std::setprecision(2) << row.ns_per_url
+               << " | " << std::setw(11) << counter(row.cycles_per_url)
+               << " | " << std::setw(9) << counter(row.instructions_per_url)
+               << " | " << std::setw(10) << counter(row.branch_misses_per_url)
+               << " | " << std::setw(11) << counter(bytes_per_cycle(row), 3)
+               << " | " << std::setw(10) << counter(row.allocs_per_url, 3)
+               << " | " << std::setw(15) << counter(row.alloc_bytes_per_url, 1)
+               << " | " << row.name << " (" << row.input_class << ")\n";
+        }
+        os.flags(flags);
+        os.precision(precision);
+    }
 
-            ankerl::nanobench::doNotOptimizeAway(url);
+    void write_csv(std::ostream& os) const {
+        os << "benchmark,class,urls,bytes_per_url,ns_per_url,cycles_per_url,"
+              "instructions_per_url,branch_misses_per_url,bytes_per_cycle,"
+              "allocs_per_url,alloc_bytes_per_url\n";
+        for (const auto& row : rows_) {
+            os << '"' << row.name << "\"," << row.input_class << ',' << row.urls << ','
+               << optional(row.bytes_per_url) << ',' << optional(row.ns_per_url) << ','
+               << optional(row.cycles_per_url) << ','
+               << optional(row.instructions_per_url) << ','
+               << optional(row.branch_misses_per_url) << ','
+               << optional(bytes_per_cycle(row)) << ','
+               << optional(row.allocs_per_url) << ','
+               << optional(row.alloc_bytes_per_url) << '\n';
         }
-    });
+    }
 
-    ankerl::nanobench::Bench().minEpochIterations(min_iters).run("Upa url::can_parse", [&] {
-        for (const auto& url_strings : url_samples) {
-            bool ok = url_strings.second.empty()
-                ? upa::url::can_parse(url_strings.first)
-                : upa::url::can_parse(url_strings.first, url_strings.second);
+    void write_json(std::ostream& os) const {
+        os << "{\n  \"results\": [";
+        for (std::size_t i = 0; i < rows_.size(); ++i) {
+            const auto& row = rows_[i];
+            os << (i ? ",\n" : "\n")
+               << "    {\"benchmark\": \"" << row.name
+               << "\", \"class\": \"" << row.input_class
+               << "\", \"urls\": " << row.urls
+               << ", \"bytes_per_url\": " << optional(row.bytes_per_url)
+               << ", \"ns_per_url\": " << optional(row.ns_per_url)
+               << ", \"cycles_per_url\": " << optional(row.cycles_per_url, "null")
+               << ", \"instructions_per_url\": " << optional(row.instructions_per_url, "null")
+               << ", \"branch_misses_per_url\": " << optional(row.branch_misses_per_url, "null")
+               << ", \"bytes_per_cycle\": " << optional(bytes_per_cycle(row), "null")
+               << ", \"allocs_per_url\": " << optional(row.allocs_per_url, "null")
+               << ", \"alloc_bytes_per_url\": " << optional(row.alloc_bytes_per_url, "null")
+               << '}';
+        }
+        os << "\n  ]\n}\n";
+    }
+
+private:
+    static double bytes_per_cycle(const url_result& row) {
+        return row.cycles_per_url > 0 ? row.bytes_per_url / row.cycles_per_url : -1.0;
+    }
+
+    static std::string counter(double value, int precision = 2) {
+        if (value < 0)
+            return "n/a";
+        std::ostringstream ss;
+        ss << std::fixed << std::setprecision(precision) << value;
+        return ss.str();
+    }
+
+    static std::string optional(double value, const char* none = "") {
+        if (value < 0)
+            return none;
+        std::ostringstream ss;
+        ss << std::setprecision(6) << value;
+        return ss.str();
+    }
+
+    std::vector<url_result> rows_;
+};
+
+// -----------------------------------------------------------------------------
+// Benchmark
+
+struct bench_options {
+    uint64_t min_iters = 3;
+    std::string format;  // "csv" or "json" for machine-readable output
+    std::string output;  // file for machine-readable output; stdout if empty
+    // human-readable output: stderr if the machine-readable output goes to stdout
+    std::ostream* log = &std::cout;
+    unsigned threads = 0; // number of threads in the throughput mode; 0 - disabled
+};
+
+// Heap allocations are counted in one more pass after the timed runs
+
+void benchmark(const url_samples& samples, const bench_options& opt, result_table& table) {
+    // All counters are divided by the batch size, i.e. normalized per URL
+    const auto bench_parse = [&](const char* input_class, const std::vector<url_sample>& class_samples) {
+        if (class_samples.empty())
+            return;
+        const auto parse_all = [&] {
+            upa::url url;
+
+            for (const auto& sample : class_samples) {
+                url.parse(sample.input, sample.base);
+
+                ankerl::nanobench::doNotOptimizeAway(url);
+            }
+        };
+        ankerl::nanobench::Bench bench;
+        bench.output(opt.log)
+            .minEpochIterations(opt.min_iters)
+            .performanceCounters(true)
+            .unit("URL")
+            .batch(class_samples.size())
+            .run(std::string("Upa url::parse (") + input_class + ")", parse_all);
+        table.add("Upa url::parse", input_class, class_samples, bench.results().back(),
+            bench::count_allocs(parse_all));
+    };
+
+    bench_parse("all", samples.all);
+    for (std::size_t ic = 0; ic < CLASS_COUNT; ++ic)
+        bench_parse(input_class_names[ic], samples.by_class[ic]);
+
+    if (samples.all.empty())
+        return;
+    const auto can_parse_all = [&] {
+        for (const auto& sample : samples.all) {
+            bool ok = upa::url::can_parse(sample.input, sample.base);
 
             ankerl::nanobench::doNotOptimizeAway(ok);
         }
-    });
+    };
+    ankerl::nanobench::Bench bench;
+    bench.output(opt.log)
+        .minEpochIterations(opt.min_iters)
+        .performanceCounters(true)
+        .unit("URL")
+        .batch(samples.all.size())
+        .run("Upa url::can_parse (all)", can_parse_all);
+    table.add("Upa url::can_parse", "all", samples.all, bench.results().back(),
+        bench::count_allocs(can_parse_all));
+}
+
+// -----------------------------------------------------------------------------
+// Multi-threaded throughput benchmark
+//
+// Each thread parses the shared samples opt.min_iters times, starting at a
+// different offset. Threads are pinned to CPUs on Linux.
+
+struct alignas(64) thread_result {
+    uint64_t urls = 0;
+    double seconds = 0;
+};
+
+void pin_thread_to_cpu(std::thread& thr, unsigned cpu) {
+#ifdef __linux__
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(cpu, &cpuset);
+    if (pthread_setaffinity_np(thr.native_handle(), sizeof(cpu_set_t), &cpuset) != 0)
+        std::cerr << "Failed to pin thread to CPU " << cpu << '\n';
+#else
+    (void)thr;
+    (void)cpu;
+#endif
+}
+
+double benchmark_threads(const std::vector<url_sample>& samples, unsigned thread_count,
+    uint64_t passes, std::vector<thread_result>& results)
+{
+    using clock = std::chrono::steady_clock;
+
+    results.assign(thread_count, thread_result{});
+    const unsigned cpu_count = std::max(std::thread::hardware_concurrency(), 1u);
+    std::atomic<unsigned> ready{ 0 };
+    std::atomic<bool> start{ false };
+
+    std::vector<std::thread> threads;
+    threads.reserve(thread_count);
+    for (unsigned ind = 0; ind < thread_count; ++ind) {
+        threads.emplace_back([&, ind] {
+            const std::size_t offset = samples.size() * ind / thread_count;
+            upa::url url;
+            ++ready;
+            while (!start.load(std::memory_order_acquire))
+                std::this_thread::yield();
+
+            const auto t0 = clock::now();
+            for (uint64_t pass = 0; pass < passes; ++pass) {
+                for (std::size_t i = 0; i < samples.size(); ++i) {
+                    const auto& sample = samples[(offset + i) % samples.size()];
+                    url.parse(sample.input, sample.base);
+
+                    ankerl::nanobench::doNotOptimizeAway(url);
+                }
+            }
+            const auto t1 = clock::now();
+            results[ind].urls = passes * samples.size();
+            results[ind].seconds = std::chrono::duration<double>(t1 - t0).count();
+        });
+        pin_thread_to_cpu(threads.back(), ind % cpu_count);
+    }
 
+    while (ready.load() != thread_count)
+        std::this_thread::yield();
+    const auto t0 = clock::now();
+    start.store(true, std::memory_order_release);
+    for (auto& thr : threads)
+        thr.join();
+    return std::chrono::duration<double>(clock::now() - t0).count();
+}
+
+// The per-thread, aggregate and single thread results are added to the table:
+// their ns/URL is the inverse of URLs/s
+void benchmark_throughput(const url_samples& samples, const bench_options& opt, result_table& table) {
+    if (samples.all.empty())
+        return;
+
+    std::vector<thread_result> results;
+    // single thread reference for the scaling efficiency
+    const double single_seconds = benchmark_threads(samples.all, 1, opt.min_iters, results);
+    const uint64_t single_urls = results[0].urls;
+    const double single_rate = static_cast<double>(single_urls) / single_seconds;
+
+    const double seconds = benchmark_threads(samples.all, opt.threads, opt.min_iters, results);
+    uint64_t total_urls = 0;
+    for (const auto& res : results)
+        total_urls += res.urls;
+    const double rate = static_cast<double>(total_urls) / seconds;
+
+    const std::string name = "Upa url::parse, " + std::to_string(opt.threads) + " thread(s)";
+    for (std::size_t ind = 0; ind < results.size(); ++ind) {
+        table.add_throughput(name + ", thread " + std::to_string(ind), samples.all,
+            results[ind].urls, results[ind].seconds);
+    }
+    table.add_throughput(name + ", aggregate", samples.all, total_urls, seconds);
+    table.add_throughput("Upa url::parse, single thread", samples.all,
+        single_urls, single_seconds);
+
+    std::ostream& log = *opt.log;
+    log << std::fixed << std::setprecision(0)
+        << "\nUpa url::parse, " << opt.threads << " thread(s), "
+        << samples.all.size() << " URLs x " << opt.min_iters << " passes\n"
+        << "| thread |       URLs/s |\n"
+           "|-------:|-------------:|\n";
+    for (std::size_t ind = 0; ind < results.size(); ++ind) {
+        log << "| " << std::setw(6) << ind
+                  << " | " << std::setw(12) << static_cast<double>(results[ind].urls) / results[ind].seconds
+                  << " |\n";
+    }
+    log << "Aggregate: " << rate << " URLs/s\n"
+        << "Single thread: " << single_rate << " URLs/s\n"
+        << std::setprecision(1)
+        << "Scaling efficiency: " << rate / (single_rate * opt.threads) * 100 << "%\n";
+    log.unsetf(std::ios_base::floatfield);
+}
+
+// Writes results in the machine-readable format, if it is requested
+int write_results(const result_table& table, const bench_options& opt) {
+    if (opt.format.empty())
+        return 0;
+
+    std::ofstream fout;
+    if (!opt.output.empty()) {
+        fout.open(opt.output, std::ios_base::out | std::ios_base::binary);
+        if (!fout.is_open()) {
+            std::cerr << "Failed to open " << opt.output << '\n';
+            return 2;
+        }
+    }
+    std::ostream& out = opt.output.empty() ? std::cout : fout;
+    if (opt.format == "csv")
+        table.write_csv(out);
+    else
+        table.write_json(out);
     return 0;
 }
 
@@ -129,26 +489,79 @@ uint64_t get_positive_or_default(const char* str, uint64_t def)
     return def;
 }
 
+void usage() {
+    std::cerr <<
+        "Usage: bench-url [<options>] <file containing URLs> [<min iterations>]\n"
+        "Options:\n"
+        "  --format=csv|json  write results in the machine-readable format\n"
+        "  --output=FILE      write machine-readable results to FILE instead of stdout;\n"
+        "                     if they go to stdout, other output goes to stderr\n"
+        "  --threads=N        parse the URLs from N threads and report URLs/s;\n"
+        "                     each thread does <min iterations> passes; the\n"
+        "                     machine-readable results have ns/URL = 1e9 / (URLs/s)\n";
+}
+
 int main(int argc, const char* argv[])
 {
-    constexpr uint64_t min_iters_def = 3;
-
-    if (argc < 2) {
-        std::cerr << "Usage: bench-url <file containing URLs> [<min iterations>]\n";
+    bench_options opt;
+    std::vector<const char*> args;
+
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        if (std::strncmp(arg, "--format=", 9) == 0) {
+            opt.format = arg + 9;
+            if (opt.format != "csv" && opt.format != "json") {
+                usage();
+                return 1;
+            }
+        } else if (std::strncmp(arg, "--output=", 9) == 0) {
+            opt.output = arg + 9;
+        } else if (std::strncmp(arg, "--threads=", 10) == 0) {
+            opt.threads = static_cast<unsigned>(std::strtoul(arg + 10, nullptr, 10));
+            if (opt.threads == 0) {
+                usage();
+                return 1;
+            }
+        } else if (std::strncmp(arg, "--", 2) == 0) {
+            usage();
+            return 1;
+        } else {
+            args.push_back(arg);
+        }
+    }
+    if (args.empty() || args.size() > 2) {
+        usage();
         return 1;
     }
-
-    const std::filesystem::path file_name = argv[1];
-    const uint64_t min_iters = argc > 2
-        ? get_positive_or_default(argv[2], min_iters_def)
-        : min_iters_def;
-
+    if (!opt.output.empty() && opt.format.empty())
+        opt.format = std::filesystem::path(opt.output).extension() == ".csv" ? "csv" : "json";
+    // keep stdout parseable
+    if (!opt.format.empty() && opt.output.empty())
+        opt.log = &std::cerr;
+
+    const std::filesystem::path file_name = args[0];
+    if (args.size() > 1)
+        opt.min_iters = get_positive_or_default(args[1], opt.min_iters);
+
+    url_samples samples;
+    int err;
     if (file_name.extension() == ".json") {
-        return benchmark_wpt(file_name.string().c_str(), min_iters);
+        err = load_wpt(file_name.string().c_str(), samples, *opt.log);
     } else if (file_name.extension() == ".txt") {
-        return benchmark_txt(file_name.string().c_str(), min_iters);
+        err = load_txt(file_name.string().c_str(), samples, *opt.log);
+    } else {
+        std::cerr << "File containing URLs should have .json or .txt extension.\n";
+        return 1;
     }
+    if (err != 0)
+        return err;
 
-    std::cerr << "File containing URLs should have .json or .txt extension.\n";
-    return 1;
+    result_table table;
+    if (opt.threads) {
+        benchmark_throughput(samples, opt, table);
+    } else {
+        benchmark(samples, opt, table);
+        table.print(*opt.log);
+    }
+    return write_results(table, opt);
 }
@@ -0,0 +1,759 @@
+// Copyright 2016-2024 Rimas Misevičius
+// Distributed under the BSD-style license that can be
+// found in the LICENSE file.
+//
+
+// Differential fuzzer
+//
+// Runs each input through an optimized code path and through the reference
+// implementation, and asserts that results are identical:
+// * URL parser vs. base_url_resolver, parser with validation error sink, and
+//   binary URL record round trip
+// * URL setters vs. url_builder
+// * percent encoding and decoding vs. straightforward implementations of the
+//   URL Standard algorithms
+// * IPv4 and IPv6 parsers and the host parser vs. literal implementations of
+//   the URL Standard algorithms
+// * lazy_search_params lookup, url_search_params name index, sorting,
+//   serialization and search_params_view vs. literal implementation of the
+//   application/x-www-form-urlencoded parser
+// If compiled with the UPA_FUZZ_COMPLEXITY macro defined, it also checks that
+// the parsing time grows linearly with the input length. This check is timing
+// based, so it is off by default: it can fail on loaded machines.
+//
+// The first input byte selects the check (bits 0-2), the base URL (bits 3-6)
+// and the host setter (bit 7).
+
+#include "upa/url.h"
+#include "upa/url_record.h"
+#include <algorithm>
+#include <cassert>
+#ifdef UPA_FUZZ_COMPLEXITY
+# include <chrono>
+#endif
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+// Base URLs
+static const upa::url base_urls[] = {
+    upa::url("http://h/p?q#f"),      // 0
+    upa::url("file://h/p?q#f"),      // 1
+    upa::url("non-spec://h/p?q#f"),  // 2
+    // with empty host
+    upa::url("file:///p?q#f"),       // 3
+    upa::url("non-spec:///p?q#f"),   // 4
+    // with null host
+    upa::url("non-spec:/p?q#f"),     // 5
+    upa::url("non-spec:p?q#f"),      // 6
+    upa::url("non-spec:/.//p?q#f"),  // 7
+};
+
+template <typename T, std::size_t N>
+constexpr std::size_t array_size(T (&)[N]) noexcept {
+    return N;
+}
+
+static const upa::base_url_resolver& get_resolver(std::size_t ind) {
+    static const upa::base_url_resolver resolvers[] = {
+        upa::base_url_resolver(base_urls[0]),
+        upa::base_url_resolver(base_urls[1]),
+        upa::base_url_resolver(base_urls[2]),
+        upa::base_url_resolver(base_urls[3]),
+        upa::base_url_resolver(base_urls[4]),
+        upa::base_url_resolver(base_urls[5]),
+        upa::base_url_resolver(base_urls[6]),
+        upa::base_url_resolver(base_urls[7]),
+    };
+    static_assert(array_size(resolvers) == array_size(base_urls), "resolver for each base URL");
+    return resolvers[ind];
+}
+
+// URL record contains all URL data, so equal records mean identical URLs
+static std::string url_record(const upa::url& u) {
+    std::string rec;
+    upa::write_url_record(u, rec);
+    return rec;
+}
+
+static void assert_same(const upa::url& u1, const upa::url& u2) {
+    assert(u1.href() == u2.href());
+    assert(url_record(u1) == url_record(u2));
+    assert(std::hash<upa::url>{}(u1) == std::hash<upa::url>{}(u2));
+}
+
+// Setters can leave different offsets of trailing empty parts than the parser,
+// so URLs are compared by their observable state
+static void assert_equivalent(const upa::url& u1, const upa::url& u2) {
+    assert(u1.href() == u2.href());
+    for (unsigned t = upa::url::SCHEME; t < upa::url::PART_COUNT; ++t) {
+        const auto pt = static_cast<upa::url::PartType>(t);
+        assert(u1.is_null(pt) == u2.is_null(pt));
+        assert(u1.is_empty(pt) == u2.is_empty(pt));
+    }
+    assert(u1.protocol() == u2.protocol());
+    assert(u1.username() == u2.username());
+    assert(u1.password() == u2.password());
+    assert(u1.host() == u2.host());
+    assert(u1.port() == u2.port());
+    assert(u1.pathname() == u2.pathname());
+    assert(u1.search() == u2.search());
+    assert(u1.hash() == u2.hash());
+    assert(u1.has_opaque_path() == u2.has_opaque_path());
+    assert(std::hash<upa::url>{}(u1) == std::hash<upa::url>{}(u2));
+}
+
+// Reference helpers
+
+static bool is_hex_digit(char c) {
+    return (c >= '0' && c <= '9') || (c >= 'A' && c <= 'F') || (c >= 'a' && c <= 'f');
+}
+
+static unsigned hex_value(char c) {
+    return c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10;
+}
+
+static std::string utf8_decode(std::string str) {
+    // UTF-8 decode without BOM, replacing invalid sequences with U+FFFD,
+    // then UTF-8 encode
+    upa::url_utf::check_fix_utf8(str);
+    return str;
+}
+
+// https://url.spec.whatwg.org/#percent-decode
+static std::string ref_percent_decode_bytes(const std::string& str) {
+    std::string out;
+    for (std::size_t i = 0; i < str.length(); ++i) {
+        if (str[i] == '%' && i + 2 < str.length() && is_hex_digit(str[i + 1]) && is_hex_digit(str[i + 2])) {
+            out.push_back(static_cast<char>(hex_value(str[i + 1]) * 16 + hex_value(str[i + 2])));
+            i += 2;
+        } else {
+            out.push_back(str[i]);
+        }
+    }
+    return out;
+}
+
+// https://url.spec.whatwg.org/#string-percent-decode
+static std::string ref_percent_decode(const std::string& str) {
+    return utf8_decode(ref_percent_decode_bytes(utf8_decode(str)));
+}
+
+// https://url.spec.whatwg.org/#string-utf-8-percent-encode
+static std::string ref_percent_encode(const std::string& str, const upa::code_point_set& no_encode_set) {
+    static const char hex[] = "0123456789ABCDEF";
+    std::string out;
+    for (const char c : utf8_decode(str)) {
+        const auto uc = static_cast<unsigned char>(c);
+        if (uc < 0x80 && no_encode_set[uc]) {
+            out.push_back(c);
+        } else {
+            out.push_back('%');
+            out.push_back(hex[uc >> 4]);
+            out.push_back(hex[uc & 0xF]);
+        }
+    }
+    return out;
+}
+
+// -----------------------------------------------------------------------------
+// URL parser
+
+static void check_parser(const std::string& inp, std::size_t base_ind) {
+    const upa::url* pbase = base_ind < array_size(base_urls) ? &base_urls[base_ind] : nullptr;
+
+    upa::url u1;
+    const auto res = u1.parse(inp, pbase);
+    const bool ok = upa::success(res);
+
+    assert(upa::url::can_parse(inp, pbase) == ok);
+
+    // parser with validation error sink
+    upa::url u2;
+    const auto res2 = u2.parse(inp, pbase, [&](upa::validation_errc, std::size_t offset) {
+        assert(offset <= inp.length());
+    });
+    assert(res2 == res);
+    if (ok)
+        assert_same(u1, u2);
+
+    // base URL resolver
+    if (pbase) {
+        upa::url u3;
+        const auto res3 = get_resolver(base_ind).resolve(inp, u3);
+        assert(res3 == res);
+        if (ok)
+            assert_same(u1, u3);
+    }
+
+    // URL record round trip
+    if (ok) {
+        const std::string rec = url_record(u1);
+        upa::url u4;
+        const char* first = rec.data();
+        assert(upa::read_url_record(first, rec.data() + rec.length(), u4));
+        assert(first == rec.data() + rec.length());
+        assert_same(u1, u4);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// URL setters
+
+static void check_setters(const std::string& inp, std::size_t base_ind, bool use_hostname) {
+    if (inp.empty()) return;
+    const upa::url& src = base_urls[base_ind % array_size(base_urls)];
+
+    // the second byte selects components to set, values are separated by '\n'
+    const auto mask = static_cast<unsigned char>(inp[0]);
+    std::vector<std::string> values;
+    std::size_t pos = 1;
+    for (unsigned bit = 0; bit < 8; ++bit) {
+        if (mask & (1u << bit)) {
+            const std::size_t end = std::min(inp.find('\n', pos), inp.length());
+            values.push_back(inp.substr(pos, end - pos));
+            pos = std::min(end + 1, inp.length());
+        } else {
+            values.push_back(std::string());
+        }
+    }
+
+    upa::url u1(src);
+    upa::url_builder builder;
+    bool ok1 = true;
+    if (mask & 0x01) { ok1 &= u1.protocol(values[0]); builder.protocol(values[0]); }
+    if (mask & 0x02) { ok1 &= u1.username(values[1]); builder.username(values[1]); }
+    if (mask & 0x04) { ok1 &= u1.password(values[2]); builder.password(values[2]); }
+    if (mask & 0x08) {
+        if (use_hostname) {
+            ok1 &= u1.hostname(values[3]); builder.hostname(values[3]);
+        } else {
+            ok1 &= u1.host(values[3]); builder.host(values[3]);
+        }
+    }
+    if (mask & 0x10) { ok1 &= u1.port(values[4]); builder.port(values[4]); }
+    if (mask & 0x20) { ok1 &= u1.pathname(values[5]); builder.pathname(values[5]); }
+    if (mask & 0x40) { ok1 &= u1.search(values[6]); builder.search(values[6]); }
+    if (mask & 0x80) { ok1 &= u1.hash(values[7]); builder.hash(values[7]); }
+
+    upa::url u2(src);
+    const bool ok2 = builder.apply(u2);
+    assert(ok1 == ok2);
+    assert_equivalent(u1, u2);
+
+    // setters must give the same URL as parsing
+    upa::url u3;
+    assert(upa::success(u3.parse(u1.href(), nullptr)));
+    assert_equivalent(u1, u3);
+    assert_equivalent(u2, u3);
+}
+
+// -----------------------------------------------------------------------------
+// Percent encoding and decoding
+
+static void check_percent(const std::string& inp) {
+    assert(upa::percent_decode(inp) == ref_percent_decode(inp));
+
+    const upa::code_point_set* const sets[] = {
+        &upa::fragment_no_encode_set,
+        &upa::query_no_encode_set,
+        &upa::special_query_no_encode_set,
+        &upa::path_no_encode_set,
+        &upa::userinfo_no_encode_set,
+        &upa::component_no_encode_set,
+    };
+    for (const auto* cpset : sets)
+        assert(upa::percent_encode(inp, *cpset) == ref_percent_encode(inp, *cpset));
+
+    // round trip
+    assert(upa::percent_decode(upa::encode_url_component(inp)) == utf8_decode(inp));
+}
+
+// -----------------------------------------------------------------------------
+// IPv4 parser
+
+// https://url.spec.whatwg.org/#ipv4-number-parser
+// Numbers greater than 2^32 are saturated.
+static bool ref_ipv4_number(std::string inp, std::uint64_t& number) {
+    if (inp.empty()) return false;
+    unsigned radix = 10;
+    if (inp.length() >= 2 && inp[0] == '0' && (inp[1] == 'x' || inp[1] == 'X')) {
+        inp.erase(0, 2);
+        radix = 16;
+    } else if (inp.length() >= 2 && inp[0] == '0') {
+        inp.erase(0, 1);
+        radix = 8;
+    }
+    number = 0;
+    for (const char c : inp) {
+        unsigned digit;
+        if (c >= '0' && c <= '9') digit = c - '0';
+        else if (radix == 16 && is_hex_digit(c)) digit = hex_value(c);
+        else return false;
+        if (digit >= radix) return false;
+        number = std::min<std::uint64_t>(number * radix + digit, std::uint64_t(1) << 33);
+    }
+    return true;
+}
+
+static std::vector<std::string> split(const std::string& str, char delim) {
+    std::vector<std::string> parts;
+    std::size_t pos = 0;
+    while (true) {
+        const std::size_t end = str.find(delim, pos);
+        parts.push_back(str.substr(pos, end - pos));
+        if (end == std::string::npos) break;
+        pos = end + 1;
+    }
+    return parts;
+}
+
+// https://url.spec.whatwg.org/#concept-ipv4-parser
+static bool ref_ipv4_parse(const std::string& inp, std::uint32_t& ipv4) {
+    std::vector<std::string> parts = split(inp, '.');
+    if (parts.back().empty() && parts.size() > 1)
+        parts.pop_back();
+    if (parts.size() > 4) return false;
+    std::vector<std::uint64_t> numbers;
+    for (const auto& part : parts) {
+        std::uint64_t n;
+        if (!ref_ipv4_number(part, n)) return false;
+        numbers.push_back(n);
+    }
+    for (std::size_t i = 0; i + 1 < numbers.size(); ++i)
+        if (numbers[i] > 255) return false;
+    if (numbers.back() >= (std::uint64_t(1) << (8 * (5 - numbers.size()))))
+        return false;
+    std::uint64_t res = numbers.back();
+    for (std::size_t i = 0; i + 1 < numbers.size(); ++i)
+        res += numbers[i] << (8 * (3 - i));
+    ipv4 = static_cast<std::uint32_t>(res);
+    return true;
+}
+
+// https://url.spec.whatwg.org/#ends-in-a-number-checker
+static bool ref_ends_in_a_number(const std::string& inp) {
+    std::vector<std::string> parts = split(inp, '.');
+    if (parts.back().empty()) {
+        if (parts.size() == 1) return false;
+        parts.pop_back();
+    }
+    const std::string& last = parts.back();
+    if (!last.empty() && std::all_of(last.begin(), last.end(), [](char c) { return c >= '0' && c <= '9'; }))
+        return true;
+    std::uint64_t n;
+    return ref_ipv4_number(last, n);
+}
+
+// https://url.spec.whatwg.org/#concept-ipv4-serializer
+static std::string ref_ipv4_serialize(std::uint32_t ipv4) {
+    std::string out;
+    for (int i = 3; i >= 0; --i) {
+        out += std::to_string((ipv4 >> (8 * i)) & 0xFF);
+        if (i) out.push_back('.');
+    }
+    return out;
+}
+
+static bool parse_host(const std::string& inp, std::string& host) {
+    try {
+        host = upa::url_host(inp).to_string();
+        return true;
+    }
+    catch (upa::url_error&) {
+        return false;
+    }
+}
+
+static void check_ipv4(const std::string& inp) {
+    std::uint32_t ipv4 = 0, ref_ipv4 = 0;
+    const bool ok = upa::success(upa::ipv4_parse(inp.data(), inp.data() + inp.length(), ipv4));
+    const bool ref_ok = ref_ipv4_parse(inp, ref_ipv4);
+    assert(ok == ref_ok);
+    if (ok)
+        assert(ipv4 == ref_ipv4);
+
+    // Host parser: ASCII alphanumeric input is lowercased by domain to ASCII
+    if (!inp.empty() && std::all_of(inp.begin(), inp.end(), [](char c) {
+        return (c >= '0' && c <= '9') || ((c | 0x20) >= 'a' && (c | 0x20) <= 'z') || c == '.'; }))
+    {
+        std::string lower(inp);
+        for (auto& c : lower) if (c >= 'A' && c <= 'Z') c |= 0x20;
+        if (ref_ends_in_a_number(lower)) {
+            std::string host;
+            const bool host_ok = parse_host(inp, host);
+            assert(host_ok == ref_ipv4_parse(lower, ref_ipv4));
+            if (host_ok)
+                assert(host == ref_ipv4_serialize(ref_ipv4));
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+// IPv6 parser
+
+// https://url.spec.whatwg.org/#concept-ipv6-parser
+static bool ref_ipv6_parse(const std::string& inp, std::uint16_t (&address)[8]) {
+    std::fill(std::begin(address), std::end(address), static_cast<std::uint16_t>(0));
+    int piece_index = 0;
+    int compress = -1;
+    std::size_t pointer = 0;
+    const auto c = [&](std::size_t i) -> int {
+        return i < inp.length() ? static_cast<unsigned char>(inp[i]) : -1;
+    };
+    const auto is_digit = [](int ch) { return ch >= '0' && ch <= '9'; };
+    const auto is_hex = [](int ch) { return ch >= 0 && is_hex_digit(static_cast<char>(ch)); };
+
+    if (c(pointer) == ':') {
+        if (c(pointer + 1) != ':') return false;
+        pointer += 2;
+        compress = ++piece_index;
+    }
+    while (c(pointer) != -1) {
+        if (piece_index == 8) return false;
+        if (c(pointer) == ':') {
+            if (compress != -1) return false;
+            ++pointer;
+            compress = ++piece_index;
+            continue;
+        }
+        unsigned value = 0, length = 0;
+        while (length < 4 && is_hex(c(pointer))) {
+            value = value * 0x10 + hex_value(static_cast<char>(c(pointer)));
+            ++pointer;
+            ++length;
+        }
+        if (c(pointer) == '.') {
+            if (length == 0) return false;
+            pointer -= length;
+            if (piece_index > 6) return false;
+            int numbers_seen = 0;
+            while (c(pointer) != -1) {
+                int ipv4_piece = -1;
+                if (numbers_seen > 0) {
+                    if (c(pointer) == '.' && numbers_seen < 4) ++pointer;
+                    else return false;
+                }
+                if (!is_digit(c(pointer))) return false;
+                while (is_digit(c(pointer))) {
+                    const int number = c(pointer) - '0';
+                    if (ipv4_piece == -1) ipv4_piece = number;
+                    else if (ipv4_piece == 0) return false;
+                    else ipv4_piece = ipv4_piece * 10 + number;
+                    if (ipv4_piece > 255) return false;
+                    ++pointer;
+                }
+                address[piece_index] = static_cast<std::uint16_t>(address[piece_index] * 0x100 + ipv4_piece);
+                ++numbers_seen;
+                if (numbers_seen == 2 || numbers_seen == 4) ++piece_index;
+            }
+            if (numbers_seen != 4) return false;
+            break;
+        }
+        if (c(pointer) == ':') {
+            ++pointer;
+            if (c(pointer) == -1) return false;
+        } else if (c(pointer) != -1) {
+            return false;
+        }
+        address[piece_index] = static_cast<std::uint16_t>(value);
+        ++piece_index;
+    }
+    if (compress != -1) {
+        int swaps = piece_index - compress;
+        piece_index = 7;
+        while (piece_index != 0 && swaps > 0) {
+            std::swap(address[piece_index], address[compress + swaps - 1]);
+            --piece_index;
+            --swaps;
+        }
+    } else if (piece_index != 8) {
+        return false;
+    }
+    return true;
+}
+
+// https://url.spec.whatwg.org/#concept-ipv6-serializer
+static std::string ref_ipv6_serialize(const std::uint16_t (&address)[8]) {
+    // the first longest sequence of two or more 0 pieces
+    int compress = -1, best_len = 1;
+    for (int i = 0; i < 8; ) {
+        int len = 0;
+        while (i + len < 8 && address[i + len] == 0) ++len;
+        if (len > best_len) {
+            compress = i;
+            best_len = len;
+        }
+        i += len ? len : 1;
+    }
+    static const char hex[] = "0123456789abcdef";
+    std::string out;
+    bool ignore0 = false;
+    for (int i = 0; i < 8; ++i) {
+        if (ignore0 && address[i] == 0) continue;
+        ignore0 = false;
+        if (compress == i) {
+            out += i == 0 ? "::" : ":";
+            ignore0 = true;
+            continue;
+        }
+        std::string piece;
+        for (unsigned v = address[i]; ; v >>= 4) {
+            piece.insert(piece.begin(), hex[v & 0xF]);
+            if (v < 0x10) break;
+        }
+        out += piece;
+        if (i != 7) out.push_back(':');
+    }
+    return out;
+}
+
+static void check_ipv6(const std::string& inp) {
+    std::uint16_t address[8], ref_address[8];
+    const bool ok = upa::success(upa::ipv6_parse(inp.data(), inp.data() + inp.length(), address));
+    const bool ref_ok = ref_ipv6_parse(inp, ref_address);
+    assert(ok == ref_ok);
+    if (ok)
+        assert(std::equal(std::begin(address), std::end(address), std::begin(ref_address)));
+
+    // Host parser
+    std::string host;
+    const bool host_ok = parse_host("[" + inp + "]", host);
+    assert(host_ok == ref_ok);
+    if (host_ok)
+        assert(host == "[" + ref_ipv6_serialize(ref_address) + "]");
+}
+
+// -----------------------------------------------------------------------------
+// Search parameters
+
+using pair_list = std::vector<std::pair<std::string, std::string>>;
+
+// https://url.spec.whatwg.org/#concept-urlencoded-parser
+static pair_list ref_form_parse(const std::string& inp) {
+    pair_list lst;
+    for (const auto& seq : split(inp, '&')) {
+        if (seq.empty()) continue;
+        const std::size_t eq = seq.find('=');
+        std::string name = seq.substr(0, eq);
+        std::string value = eq == std::string::npos ? std::string() : seq.substr(eq + 1);
+        std::replace(name.begin(), name.end(), '+', ' ');
+        std::replace(value.begin(), value.end(), '+', ' ');
+        lst.emplace_back(
+            utf8_decode(ref_percent_decode_bytes(name)),
+            utf8_decode(ref_percent_decode_bytes(value)));
+    }
+    return lst;
+}
+
+// https://url.spec.whatwg.org/#concept-urlencoded-serializer
+static std::string ref_form_serialize(const pair_list& lst) {
+    static const char hex[] = "0123456789ABCDEF";
+    const auto encode = [](const std::string& str, std::string& out) {
+        for (const char c : str) {
+            const auto uc = static_cast<unsigned char>(c);
+            if ((uc >= '0' && uc <= '9') || ((uc | 0x20) >= 'a' && (uc | 0x20) <= 'z') ||
+                uc == '*' || uc == '-' || uc == '.' || uc == '_') {
+                out.push_back(c);
+            } else if (uc == ' ') {
+                out.push_back('+');
+            } else {
+                out.push_back('%');
+                out.push_back(hex[uc >> 4]);
+                out.push_back(hex[uc & 0xF]);
+            }
+        }
+    };
+    std::string out;
+    bool first = true;
+    for (const auto& p : lst) {
+        if (!first) out.push_back('&');
+        first = false;
+        encode(p.first, out);
+        out.push_back('=');
+        encode(p.second, out);
+    }
+    return out;
+}
+
+static std::u16string to_utf16(const std::string& str) {
+    upa::simple_buffer<char16_t> buff;
+    upa::url_utf::convert_utf8_to_utf16(str.data(), str.data() + str.length(), buff);
+    return std::u16string(buff.data(), buff.size());
+}
+
+static bool equal_str(upa::string_view a, upa::string_view b) {
+    return a.size() == b.size() && std::equal(a.data(), a.data() + a.size(), b.data());
+}
+
+template <class ParamsT>
+static bool equal_list(const ParamsT& params, const pair_list& lst) {
+    auto it = lst.begin();
+    for (const auto& p : params) {
+        if (it == lst.end() || !equal_str(it->first, p.first) || !equal_str(it->second, p.second))
+            return false;
+        ++it;
+    }
+    return it == lst.end();
+}
+
+static void check_search_params(const std::string& inp) {
+    // the url_search_params(query) and search_params_view remove leading "?"
+    const pair_list ref = ref_form_parse(!inp.empty() && inp[0] == '?' ? inp.substr(1) : inp);
+
+    // parsing
+    const upa::url_search_params params(inp);
+    assert(equal_list(params, ref));
+    assert(equal_list(upa::search_params_view(inp), ref));
+
+    // distinct names in order of appearance
+    std::vector<std::string> names;
+    for (const auto& p : ref) {
+        if (names.size() < 32 && std::find(names.begin(), names.end(), p.first) == names.end())
+            names.push_back(p.first);
+    }
+    names.push_back("\xEF\xBF\xBD-not-in-list");
+
+    for (const auto& name : names) {
+        std::vector<std::string> ref_values;
+        for (const auto& p : ref)
+            if (p.first == name) ref_values.push_back(p.second);
+
+        // lookup in the not yet parsed query
+        const upa::lazy_search_params lazy(inp);
+        const std::string* value = lazy.get(name);
+        assert(ref_values.empty() ? value == nullptr : value != nullptr && *value == ref_values.front());
+        assert(upa::lazy_search_params(inp).has(name) == !ref_values.empty());
+
+        // lookup in the parsed list, using the name index if the list is large
+        const std::list<std::string> values = params.get_all(name);
+        assert(values.size() == ref_values.size() &&
+            std::equal(values.begin(), values.end(), ref_values.begin()));
+    }
+
+    // sorting by UTF-16 code units
+    pair_list ref_sorted = ref;
+    std::stable_sort(ref_sorted.begin(), ref_sorted.end(), [](const pair_list::value_type& a, const pair_list::value_type& b) {
+        return to_utf16(a.first) < to_utf16(b.first);
+    });
+    upa::url_search_params sorted(inp);
+    sorted.sort();
+    assert(equal_list(sorted, ref_sorted));
+
+    // serializing
+    const std::string serialized = params.to_string();
+    assert(serialized == ref_form_serialize(ref));
+    assert(equal_list(upa::url_search_params(serialized), ref));
+}
+
+// -----------------------------------------------------------------------------
+// Algorithmic complexity
+
+#ifdef UPA_FUZZ_COMPLEXITY
+
+// Returns the shortest of several run times in nanoseconds
+template <class Fn>
+static std::int64_t min_run_time(Fn fn) {
+    std::int64_t best = INT64_MAX;
+    for (int run = 0; run < 3; ++run) {
+        const auto start = std::chrono::steady_clock::now();
+        fn();
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min<std::int64_t>(best,
+            std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    }
+    return best;
+}
+
+// Run time of linear algorithms for 16 times longer input must be about 16
+// times longer (quadratic: 256 times). Reported are inputs whose run time
+// grows more than 64 times in each of several measurements; the run times
+// under 1 ms are not compared as they are too noisy.
+template <class Fn>
+static void check_linear(const std::string& inp, Fn fn) {
+    const int kAttempts = 3;
+    const std::size_t kMinLength = 4096;
+    const std::size_t kScale = 16;
+
+    std::string small;
+    while (small.length() < kMinLength)
+        small += inp;
+    std::string large;
+    for (std::size_t i = 0; i < kScale; ++i)
+        large += small;
+
+    bool is_linear = false;
+    // the input is measured again to rule out the machine load spikes
+    for (int attempt = 0; attempt < kAttempts && !is_linear; ++attempt) {
+        const std::int64_t t_small = min_run_time([&] { fn(small); });
+        const std::int64_t t_large = min_run_time([&] { fn(large); });
+        is_linear = t_large < 1000000 || t_large < t_small * static_cast<std::int64_t>(kScale * 4);
+    }
+    assert(is_linear);
+    (void)is_linear;
+}
+
+static void check_complexity(const std::string& inp, std::size_t base_ind) {
+    if (inp.empty()) return;
+    const upa::url* pbase = base_ind < array_size(base_urls) ? &base_urls[base_ind] : nullptr;
+
+    check_linear(inp, [&](const std::string& str) {
+        upa::url u;
+        u.parse(str, pbase);
+    });
+    check_linear(inp, [](const std::string& str) {
+        upa::url_search_params params(str);
+        params.sort();
+        params.to_string();
+    });
+    check_linear(inp, [](const std::string& str) {
+        upa::percent_decode(str);
+    });
+}
+
+#endif // UPA_FUZZ_COMPLEXITY
+
+// Use libFuzzer interface
+// https://llvm.org/docs/LibFuzzer.html
+
+extern "C" int LLVMFuzzerTestOneInput(const char* data, std::size_t size) {
+    if (size < 1) return 0;
+    const auto selector = static_cast<unsigned char>(data[0]);
+    const std::size_t base_ind = (selector >> 3) & 0x0F;
+    const bool use_hostname = (selector & 0x80) != 0;
+
+    // skip first byte of data
+    const std::string inp(data + 1, size - 1);
+
+    switch (selector & 0x07) {
+    case 0:
+    case 1:
+        check_parser(inp, base_ind);
+        break;
+    case 2:
+        check_setters(inp, base_ind, use_hostname);
+        break;
+    case 3:
+        check_percent(inp);
+        break;
+    case 4:
+        check_ipv4(inp);
+        break;
+    case 5:
+        check_ipv6(inp);
+        break;
+    case 6:
+        check_search_params(inp);
+        break;
+    case 7:
+#ifdef UPA_FUZZ_COMPLEXITY
+        check_complexity(inp, base_ind);
+#endif
+        break;
+    }
+    return 0;
+}
@@ -131,15 +131,18 @@ enum {
     ERR_EXCEPTION = 8
 };
 
-// Parses a JSON file using the specified PicoJSON parsing context
+// Parses a JSON file using the specified PicoJSON parsing context; the
+// title line is written to the `out` stream
 
 template <typename Context>
-inline int load_file(Context& ctx, const char* file_name, const char* title = nullptr) {
+inline int load_file(Context& ctx, const char* file_name, const char* title = nullptr,
+    std::ostream& out = std::cout)
+{
     try {
         if (title)
-            std::cout << title << ": " << file_name << '\n';
+            out << title << ": " << file_name << '\n';
         else
-            std::cout << "========== " << file_name << " ==========\n";
+            out << "========== " << file_name << " ==========\n";
 
         std::ifstream file(file_name, std::ios_base::in | std::ios_base::binary);
         if (!file.is_open()) {
@@ -0,0 +1,132 @@
+// Copyright 2016-2024 Rimas Misevičius
+// Distributed under the BSD-style license that can be
+// found in the LICENSE file.
+//
+
+#include "upa/url_corpus.h"
+#include "doctest-main.h"
+#include <algorithm>
+#include <string>
+#include <vector>
+
+static std::vector<std::string> sorted_hrefs(std::size_t count) {
+    std::vector<std::string> hrefs;
+    for (std::size_t ind = 0; ind < count; ++ind) {
+        const std::string num = std::to_string(ind);
+        switch (ind % 4) {
+        case 0: hrefs.push_back("https://example.org/dir/" + num + "?q=" + num); break;
+        case 1: hrefs.push_back("https://example.org/" + num + "#f"); break;
+        case 2: hrefs.push_back("http://h" + std::to_string(ind % 7) + ".example/a/b/" + num); break;
+        case 3: hrefs.push_back("foo:" + num); break;
+        }
+    }
+    // serialize and sort
+    for (auto& href : hrefs)
+        href = std::string(upa::url(href).href());
+    std::sort(hrefs.begin(), hrefs.end());
+    return hrefs;
+}
+
+TEST_CASE("url_corpus_writer and url_corpus") {
+    const auto hrefs = sorted_hrefs(1000);
+
+    for (const std::size_t block_size : { 1, 3, 16 }) {
+        INFO("block size: ", block_size);
+        upa::url_corpus_writer writer(block_size);
+        for (const auto& href : hrefs)
+            CHECK(writer.add(upa::url(href)));
+        // not sorted
+        CHECK_FALSE(writer.add(upa::url(hrefs.front())));
+        CHECK(writer.size() == hrefs.size());
+        const std::string data = writer.finish();
+        CHECK(writer.size() == 0);
+        // front coding makes it smaller than not compressed records
+        std::string records;
+        for (const auto& href : hrefs)
+            upa::write_url_record(upa::url(href), records);
+        if (block_size > 1)
+            CHECK(data.length() < records.length());
+
+        upa::url_corpus corpus;
+        REQUIRE(corpus.open(data));
+        CHECK(corpus.size() == hrefs.size());
+
+        // random access
+        for (std::size_t ind = 0; ind < hrefs.size(); ind += 37) {
+            upa::url u;
+            REQUIRE(corpus.get(ind, u));
+            const upa::url expected(hrefs[ind]);
+            CHECK(u == expected);
+            CHECK(u.is_valid());
+            CHECK(u.pathname() == expected.pathname());
+            CHECK(u.search() == expected.search());
+            CHECK(u.is_special_scheme() == expected.is_special_scheme());
+        }
+        upa::url u;
+        CHECK_FALSE(corpus.get(hrefs.size(), u));
+
+        // full scan
+        std::size_t ind = 0;
+        CHECK(corpus.scan(0, corpus.size(), [&](const upa::url& su) {
+            CHECK(su.href() == hrefs[ind++]);
+        }));
+        CHECK(ind == hrefs.size());
+
+        // prefix range
+        const char* const prefixes[] = {
+            "https://example.org/dir/", "https://example.org/", "http://h3.example/",
+            "foo:1", "foo:", "", "zzz", "a", "https://example.org/dir/999"
+        };
+        for (const auto* prefix : prefixes) {
+            INFO("prefix: ", prefix);
+            const std::string pref(prefix);
+            std::vector<std::string> expected;
+            for (const auto& href : hrefs) {
+                if (href.compare(0, pref.length(), pref) == 0)
+                    expected.push_back(href);
+            }
+            const auto range = corpus.prefix_range(pref);
+            CHECK(range.second - range.first == expected.size());
+            std::vector<std::string> found;
+            CHECK(corpus.scan_prefix(pref, [&](const upa::url& su) {
+                found.emplace_back(su.href());
+            }));
+            CHECK(found == expected);
+        }
+
+        // lower_bound
+        CHECK(corpus.lower_bound("") == 0);
+        CHECK(corpus.lower_bound(hrefs[500]) == 500);
+        CHECK(corpus.lower_bound(hrefs[500] + '\0') == 501);
+        CHECK(corpus.lower_bound("~") == hrefs.size());
+    }
+}
+
+TEST_CASE("url_corpus rejects corrupted data") {
+    const auto hrefs = sorted_hrefs(50);
+    upa::url_corpus_writer writer(8);
+    for (const auto& href : hrefs)
+        writer.add(upa::url(href));
+    const std::string data = writer.finish();
+
+    upa::url_corpus corpus;
+    REQUIRE(corpus.open(data));
+
+    // empty corpus
+    CHECK(corpus.open(writer.finish()));
+    CHECK(corpus.empty());
+
+    // truncated data
+    for (std::size_t len = 0; len < data.length(); len += 7)
+        CHECK_FALSE(corpus.open(upa::string_view(data.data(), len)));
+
+    // each corrupted byte
+    for (std::size_t ind = 0; ind < data.length(); ++ind) {
+        std::string corrupted = data;
+        corrupted[ind] = static_cast<char>(corrupted[ind] ^ 0x10);
+        INFO("index: ", ind);
+        const bool ok = corpus.open(corrupted) &&
+            corpus.scan(0, corpus.size(), [](const upa::url&) {});
+        CHECK_FALSE(ok);
+    }
+}
@@ -0,0 +1,83 @@
+// Copyright 2016-2024 Rimas Misevičius
+// Distributed under the BSD-style license that can be
+// found in the LICENSE file.
+//
+
+#include "upa/url.h"
+#include "upa/url_instrumentation.h"
+#include "doctest-main.h"
+#include <thread>
+
+#ifdef UPA_URL_INSTRUMENTATION
+
+using upa::detail::url_parser;
+using upa::instrumentation::counters;
+using upa::instrumentation::slow_path;
+
+static std::uint64_t slow_count(const counters& ctrs, slow_path sp) {
+    return ctrs.slow[static_cast<std::size_t>(sp)];
+}
+
+TEST_CASE("Instrumentation counts parser states") {
+    upa::instrumentation::take_thread_counters();
+
+    upa::url u("https://example.org:8080/a?b#c");
+    const counters ctrs = upa::instrumentation::take_thread_counters();
+    CHECK(ctrs.state[url_parser::scheme_start_state] == 1);
+    CHECK(ctrs.state[url_parser::scheme_state] == 1);
+    CHECK(ctrs.state[url_parser::special_authority_slashes_state] == 1);
+    CHECK(ctrs.state[url_parser::authority_state] == 1);
+    CHECK(ctrs.state[url_parser::port_state] == 1);
+    CHECK(ctrs.state[url_parser::query_state] == 1);
+    CHECK(ctrs.state[url_parser::fragment_state] == 1);
+    CHECK(ctrs.state[url_parser::file_state] == 0);
+    CHECK(ctrs.state[url_parser::opaque_path_state] == 0);
+    for (std::size_t sp = 0; sp < upa::instrumentation::slow_path_count; ++sp)
+        CHECK(ctrs.slow[sp] == 0);
+
+    // counters were reset
+    CHECK(upa::instrumentation::thread_counters().state[url_parser::scheme_state] == 0);
+}
+
+TEST_CASE("Instrumentation counts slow paths") {
+    upa::instrumentation::take_thread_counters();
+
+    upa::url u("https://\xC4\x85.example/a\t/../b c?\xC4\x8D");
+    const counters ctrs = upa::instrumentation::take_thread_counters();
+    CHECK(slow_count(ctrs, slow_path::remove_whitespace) == 1);
+    CHECK(slow_count(ctrs, slow_path::host_idna) == 1);
+    CHECK(slow_count(ctrs, slow_path::path_shorten) == 1);
+    // " " in the path and 2 bytes of U+010D in the query
+    CHECK(slow_count(ctrs, slow_path::percent_encode) == 3);
+}
+
+TEST_CASE("Instrumentation counters are thread local and aggregatable") {
+    upa::instrumentation::take_thread_counters();
+
+    counters total;
+    std::thread thr([&] {
+        upa::url u("http://example.org/../a");
+        total += upa::instrumentation::take_thread_counters();
+    });
+    thr.join();
+    CHECK(upa::instrumentation::thread_counters().state[url_parser::scheme_state] == 0);
+
+    upa::url u("http://example.org/../a");
+    total += upa::instrumentation::take_thread_counters();
+    CHECK(total.state[url_parser::scheme_state] == 2);
+    CHECK(slow_count(total, slow_path::path_shorten) == 2);
+
+    CHECK(std::string(upa::instrumentation::state_name(url_parser::path_start_state)) == "path_start");
+    CHECK(std::string(upa::instrumentation::slow_path_name(slow_path::host_idna)) == "host_idna");
+    CHECK(upa::instrumentation::state_name(upa::instrumentation::state_count) == nullptr);
+}
+
+#else
+
+TEST_CASE("Instrumentation macros expand to nothing") {
+    UPA_INSTRUMENT_STATE(0);
+    UPA_INSTRUMENT_SLOW_PATH(any_name);
+    CHECK(upa::url::can_parse("https://example.org/"));
+}
+
+#endif
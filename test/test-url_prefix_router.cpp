@@ -0,0 +1,82 @@
+// Copyright 2016-2024 Rimas Misevičius
+// Distributed under the BSD-style license that can be
+// found in the LICENSE file.
+//
+
+#include "upa/url_prefix_router.h"
+#include "doctest-main.h"
+#include <memory>
+#include <string>
+
+using router_type = upa::url_prefix_router<std::string>;
+
+static std::string route(const router_type& router, const char* str_url) {
+    const std::string* value = router.find(upa::url(str_url));
+    return value ? *value : "(none)";
+}
+
+TEST_CASE("url_prefix_router finds the longest matching rule") {
+    const router_type router = router_type::builder{}
+        .add("example.org", "/", "root")
+        .add("example.org", "/api", "api")
+        .add("example.org", "/api/v1/", "api-v1")
+        .add("example.org", "/api/v1/users/admin", "admin")
+        .add("example.org", "/static/%C4%85", "static")
+        .add("other.org", "/api", "other-api")
+        .add("xn--a-dia.org", "/", "idn")
+        .add_any_host("/.well-known", "well-known")
+        .add_any_host("/api/v2", "any-api-v2")
+        .build();
+    CHECK(router.size() == 9);
+
+    CHECK(route(router, "https://example.org") == "root");
+    CHECK(route(router, "https://example.org/") == "root");
+    CHECK(route(router, "https://example.org/index.html") == "root");
+    CHECK(route(router, "https://example.org/api") == "api");
+    CHECK(route(router, "https://example.org/api/") == "api");
+    CHECK(route(router, "https://example.org/api/v10") == "api");
+    CHECK(route(router, "https://example.org/api/v1") == "api-v1");
+    CHECK(route(router, "https://example.org/api/v1/users?x#y") == "api-v1");
+    CHECK(route(router, "https://example.org/api/v1/users/admin/x") == "admin");
+    CHECK(route(router, "https://example.org/api/v1/users/adm") == "api-v1");
+    CHECK(route(router, "https://example.org/static/\xC4\x85/x") == "static");
+    CHECK(route(router, "https://EXAMPLE.org:8080/api/./x/../v1") == "api-v1");
+    // host rules take precedence
+    CHECK(route(router, "https://example.org/.well-known/x") == "root");
+    CHECK(route(router, "https://example.org/api/v2") == "api");
+    // other hosts
+    CHECK(route(router, "http://other.org/api/v1") == "other-api");
+    CHECK(route(router, "http://other.org/") == "(none)");
+    CHECK(route(router, "http://other.org/api/v2/x") == "other-api");
+    CHECK(route(router, "http://other.org/.well-known") == "well-known");
+    CHECK(route(router, "http://a\xC4\x8D.org/path") == "idn");
+    CHECK(route(router, "http://unknown/.well-known/acme") == "well-known");
+    CHECK(route(router, "http://unknown/api/v2/x") == "any-api-v2");
+    CHECK(route(router, "foo:/.well-known") == "well-known");
+    CHECK(route(router, "foo:.well-known") == "(none)");
+    CHECK(route(router, "foo://example.org/api") == "api");
+}
+
+TEST_CASE("url_prefix_router rules replacement and snapshots") {
+    router_type::builder builder;
+    builder.add("h", "/a", "1");
+    builder.add("h", "a/", "2");
+    builder.add_any_host("", "any");
+
+    std::shared_ptr<const router_type> router = std::make_shared<router_type>(builder.build());
+    CHECK(router->size() == 2);
+    CHECK(route(*router, "http://h/a/b") == "2");
+    CHECK(route(*router, "sc:opaque") == "any");
+
+    // reload
+    const auto old_router = router;
+    builder.add("h", "/a/b", "3");
+    std::atomic_store(&router, std::make_shared<const router_type>(builder.build()));
+    CHECK(route(*router, "http://h/a/b") == "3");
+    CHECK(route(*old_router, "http://h/a/b") == "2");
+
+    // empty router
+    const router_type empty_router;
+    CHECK(empty_router.empty());
+    CHECK(route(empty_router, "http://h/a/b") == "(none)");
+}
@@ -244,6 +244,59 @@ TEST_CASE("url_search_params::parse") {
     CHECK(params.to_string() == "c=d");
 }
 
+TEST_CASE("lazy_search_params") {
+    const char* query = "?a=1&&b=%41+x&%62=2&c&%FF=%FE";
+
+    SUBCASE("first get") {
+        const upa::lazy_search_params params(query);
+        const std::string* value = params.get("b");
+        REQUIRE(value != nullptr);
+        CHECK(*value == "A x");
+        // repeated lookup
+        value = params.get("b");
+        REQUIRE(value != nullptr);
+        CHECK(*value == "A x");
+        CHECK(params.params().get_all("b") == std::list<std::string>{ "A x", "2" });
+    }
+    SUBCASE("first get of decoded name") {
+        const upa::lazy_search_params params(query);
+        const std::string* value = params.get("\xEF\xBF\xBD");
+        REQUIRE(value != nullptr);
+        CHECK(*value == "\xEF\xBF\xBD");
+        CHECK(params.params().size() == 5);
+    }
+    SUBCASE("first get of missing name") {
+        const upa::lazy_search_params params(query);
+        CHECK(params.get("d") == nullptr);
+        CHECK(params.get("d") == nullptr);
+    }
+    SUBCASE("first has") {
+        const upa::lazy_search_params params(query);
+        CHECK(params.has("c"));
+        CHECK(params.has("c"));
+        CHECK_FALSE(params.has("="));
+        CHECK(params.get("c") != nullptr);
+    }
+    SUBCASE("empty pairs") {
+        const upa::lazy_search_params params("&&");
+        CHECK(params.get("") == nullptr);
+        CHECK(params.params().empty());
+    }
+    SUBCASE("get and modify") {
+        upa::lazy_search_params params(query);
+        CHECK(params.get("a") != nullptr);
+        params.params().append("d", "4");
+        CHECK(params.params().to_string() == "a=1&b=A+x&b=2&c=&%EF%BF%BD=%EF%BF%BD&d=4");
+        CHECK(params.has("d"));
+    }
+    SUBCASE("copy") {
+        const upa::lazy_search_params params(query);
+        const upa::lazy_search_params params_copy(params);
+        CHECK(params_copy.params().to_string() == params.params().to_string());
+        CHECK(params_copy.params().to_string() == "a=1&b=A+x&b=2&c=&%EF%BF%BD=%EF%BF%BD");
+    }
+}
+
 TEST_CASE("url_search_params::remove...") {
     SUBCASE("url_search_params::remove") {
         upa::url_search_params params("a=a&a=A&b=b&b=B");
@@ -312,6 +365,34 @@ TEST_CASE("url_search_params::sort()") {
 }
 
 
+TEST_CASE("url_search_params::sort() preserves order of equal names") {
+    const std::u32string names[] = {
+        U"b", U"a", U"\uE000", U"ab", U"\U00010000", U"", U"\u0104", U"A", U"a\u0104"
+    };
+    for (const bool ascii_only : { true, false }) {
+        INFO(ascii_only);
+        std::vector<std::pair<std::u32string, std::u32string>> input;
+        for (int i = 0; i < 60; ++i) {
+            const std::u32string& name = names[(i * 7) % (ascii_only ? 3 : 9)];
+            if (ascii_only && name[0] > 0x7F) continue;
+            input.emplace_back(name, std::u32string(1, static_cast<char32_t>('0' + i % 10)));
+        }
+        upa::url_search_params params(input);
+        // expected order
+        auto expected = upa::url_search_params::do_parse(false, params.to_string());
+        expected.sort([](const upa::url_search_params::name_value_pair& a,
+            const upa::url_search_params::name_value_pair& b) {
+            return upa::url_utf::compare_by_code_units(
+                a.first.data(), a.first.data() + a.first.size(),
+                b.first.data(), b.first.data() + b.first.size()) < 0;
+        });
+        params.sort();
+        REQUIRE(params.size() == expected.size());
+        CHECK(std::equal(params.begin(), params.end(), expected.begin()));
+    }
+}
+
+
 // Test url::search_params()
 
 TEST_CASE("url::search_params()") {
@@ -483,6 +564,52 @@ TEST_CASE("url::search_params() and url::search(...)") {
     CHECK(params.to_string() == "%3Fa=b&c=d");
 }
 
+TEST_CASE("url::search_params().edit()") {
+    upa::url url("http://h/p?a=1");
+
+    SUBCASE("commit") {
+        auto tx = url.search_params().edit();
+        tx->append("b", "2");
+        tx->set("a", "A");
+        (*tx).append("c", "3");
+        CHECK(url.search() == "?a=1");
+        tx.commit();
+        CHECK(url.search() == "?a=A&b=2&c=3");
+        // repeated commit does nothing
+        tx.commit();
+        url.search_params().append("d", "4");
+        CHECK(url.search() == "?a=A&b=2&c=3&d=4");
+    }
+    SUBCASE("commit on destruction") {
+        {
+            auto tx = url.search_params().edit();
+            tx->del("a");
+            CHECK(url.search() == "?a=1");
+        }
+        CHECK(url.search() == "");
+        CHECK(url.href() == "http://h/p");
+    }
+    SUBCASE("nested transactions") {
+        auto tx1 = url.search_params().edit();
+        {
+            auto tx2 = url.search_params().edit();
+            tx2->append("b", "2");
+        }
+        CHECK(url.search() == "?a=1");
+        tx1->sort();
+        tx1.commit();
+        CHECK(url.search() == "?a=1&b=2");
+    }
+    SUBCASE("URL modified during transaction") {
+        auto tx = url.search_params().edit();
+        tx->append("b", "2");
+        url.search("x=y z");
+        tx.commit();
+        CHECK(url.search() == "?x=y%20z");
+        CHECK(list_eq(url.search_params(), pairs_list_t<std::string>{ {"x", "y z"} }));
+    }
+}
+
 TEST_CASE("url::search_params() and url::clear()") {
     upa::url url("http://h/p?a=A&b=B");
     auto& params = url.search_params();
@@ -500,3 +627,52 @@ TEST_CASE("url::search_params() and url::clear()") {
     CHECK(params.empty());
     CHECK(params.size() == 0);
 }
+
+// Test search_params_view
+
+TEST_CASE("search_params_view") {
+    const char* queries[] = {
+        "",
+        "?",
+        "&&",
+        "?a=1&b=2",
+        "a&=&b==&=c",
+        "a+b=c+d&%41%4a=%4G%",
+        "%FF=%C4%85&\xC4\x85=\xFF&\xC4",
+    };
+    for (const char* query : queries) {
+        INFO(query);
+        const upa::search_params_view view{ upa::string_view(query) };
+        const auto lst = upa::url_search_params::do_parse(true, query);
+
+        auto it = view.begin();
+        for (const auto& p : lst) {
+            REQUIRE(it != view.end());
+            CHECK(it->first == p.first);
+            CHECK(it->second == p.second);
+            ++it;
+        }
+        CHECK(it == view.end());
+        CHECK(view.empty() == lst.empty());
+    }
+
+    SUBCASE("zero-copy") {
+        const std::string query = "?name=value&a+b=%41";
+        const upa::search_params_view view{ upa::string_view(query) };
+        auto it = view.begin();
+        CHECK(it->first.data() == query.data() + 1);
+        CHECK(it->second.data() == query.data() + 6);
+        const auto it_copy = it++;
+        CHECK(it_copy->first == "name");
+        CHECK(it->first == "a b");
+        CHECK(it->second == "A");
+    }
+
+    SUBCASE("url::search()") {
+        const upa::url url("http://h/?x=1&y=2");
+        std::string names;
+        for (const auto& p : upa::search_params_view(url.search()))
+            names.append(p.first.data(), p.first.length());
+        CHECK(names == "xy");
+    }
+}
@@ -0,0 +1,105 @@
+// Copyright 2016-2024 Rimas Misevičius
+// Distributed under the BSD-style license that can be
+// found in the LICENSE file.
+//
+
+#include "upa/url_table.h"
+#include "doctest-main.h"
+#include <map>
+#include <string>
+
+TEST_CASE("url_table stores URL parts in columns") {
+    const char* const urls[] = {
+        "http://example.org/a?q=1#f",
+        "https://example.org:8443/b",
+        "foo://example.org/a?",
+        "ws://other:8443/",
+        "foo:opaque#",
+        "file:///C:/dir/file",
+    };
+    const upa::url_table::ColumnType col_types[] = {
+        upa::url_table::SCHEME, upa::url_table::HOST, upa::url_table::PORT,
+        upa::url_table::PATH, upa::url_table::QUERY, upa::url_table::FRAGMENT
+    };
+    const upa::url::PartType part_types[] = {
+        upa::url::SCHEME, upa::url::HOST, upa::url::PORT,
+        upa::url::PATH, upa::url::QUERY, upa::url::FRAGMENT
+    };
+
+    upa::url_table table;
+    CHECK(table.empty());
+    for (const auto* str : urls)
+        CHECK(table.append(str) == upa::validation_errc::ok);
+    // invalid URL is not appended
+    CHECK(table.append("http://[/") != upa::validation_errc::ok);
+    CHECK(table.size() == 6);
+
+    for (std::size_t row = 0; row < table.size(); ++row) {
+        const upa::url u(urls[row]);
+        INFO("URL: ", urls[row]);
+        for (int ind = 0; ind < upa::url_table::COLUMN_COUNT; ++ind) {
+            const auto& col = table.get_column(col_types[ind]);
+            CHECK(col.size() == table.size());
+            CHECK(col.value_at(row) == u.get_part_view(part_types[ind]));
+            CHECK(table.get(row, col_types[ind]) == u.get_part_view(part_types[ind]));
+            CHECK(col.is_null(row) == u.is_null(part_types[ind]));
+            CHECK(col.value(col.id(row)) == col.value_at(row));
+        }
+    }
+
+    // dictionary encoding
+    const auto& hosts = table.get_column(upa::url_table::HOST);
+    CHECK(hosts.dictionary_size() == 4); // null, "example.org", "other", ""
+    CHECK(hosts.id(0) == hosts.id(1));
+    CHECK(hosts.id(0) == hosts.id(2));
+    CHECK(hosts.id(4) == upa::url_table::null_id);
+    const auto& ports = table.get_column(upa::url_table::PORT);
+    CHECK(ports.id(1) == ports.id(3));
+    CHECK(ports.is_null(0));
+    // empty query and fragment are not null
+    CHECK_FALSE(table.get_column(upa::url_table::QUERY).is_null(2));
+    CHECK_FALSE(table.get_column(upa::url_table::FRAGMENT).is_null(4));
+
+    // group by host
+    std::map<std::string, int> host_count;
+    for (const auto id : hosts.ids())
+        ++host_count[std::string(hosts.value(id))];
+    CHECK(host_count["example.org"] == 3);
+    CHECK(host_count["other"] == 1);
+
+    // scheme ids
+    upa::url_table::value_id id_http = 0, id_foo = 0, id_id = 0;
+    CHECK(table.scheme_id("http", id_http));
+    CHECK(table.scheme_id("foo", id_foo));
+    CHECK_FALSE(table.scheme_id("bar", id_id));
+    const auto& schemes = table.get_column(upa::url_table::SCHEME);
+    CHECK(schemes.id(0) == id_http);
+    CHECK(schemes.id(2) == id_foo);
+    CHECK(schemes.id(4) == id_foo);
+
+    // special scheme ids do not depend on data
+    upa::url_table table2;
+    CHECK(table2.append("foo:") == upa::validation_errc::ok);
+    CHECK(table2.append("http://h/") == upa::validation_errc::ok);
+    CHECK(table2.get_column(upa::url_table::SCHEME).id(1) == id_http);
+    CHECK(table2.scheme_id("http", id_id));
+    CHECK(id_id == id_http);
+
+    table.clear();
+    CHECK(table.empty());
+    CHECK(table.get_column(upa::url_table::HOST).dictionary_size() == 1);
+    CHECK(table.scheme_id("http", id_id));
+    CHECK(id_id == id_http);
+}
+
+TEST_CASE("url_table with many rows") {
+    upa::url_table table;
+    const upa::url base("https://example.org/dir/");
+    for (int ind = 0; ind < 10000; ++ind)
+        CHECK(table.append("/p" + std::to_string(ind % 1000) + "?" + std::to_string(ind), &base) == upa::validation_errc::ok);
+    CHECK(table.get_column(upa::url_table::HOST).dictionary_size() == 2);
+    CHECK(table.get_column(upa::url_table::PATH).dictionary_size() == 1001);
+    CHECK(table.get_column(upa::url_table::QUERY).dictionary_size() == 10001);
+    CHECK(table.get(1234, upa::url_table::PATH) == "/p234");
+    CHECK(table.get(1234, upa::url_table::QUERY) == "1234");
+}
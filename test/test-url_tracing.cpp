@@ -0,0 +1,111 @@
+// Copyright 2016-2024 Rimas Misevičius
+// Distributed under the BSD-style license that can be
+// found in the LICENSE file.
+//
+
+#include "upa/url.h"
+#include "upa/url_tracing.h"
+#include "doctest-main.h"
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef UPA_URL_TRACING
+
+class recording_tracer : public upa::tracing::tracer {
+public:
+    void begin(const char* name) override {
+        events.push_back(std::string("B ") + name);
+    }
+    void end(const char* name) override {
+        events.push_back(std::string("E ") + name);
+    }
+
+    std::vector<std::string> events;
+};
+
+// Sets the tracer for the lifetime of this object
+class tracer_guard {
+public:
+    explicit tracer_guard(upa::tracing::tracer& tr) {
+        upa::tracing::set_tracer(&tr);
+    }
+    ~tracer_guard() {
+        upa::tracing::set_tracer(nullptr);
+    }
+};
+
+TEST_CASE("Tracing of URL parsing") {
+    recording_tracer tr;
+    {
+        const tracer_guard guard(tr);
+        upa::url u("https://\xC4\x85.example/?a=b");
+        CHECK(u.search_params().size() == 1);
+    }
+    // not traced
+    upa::url u("https://example.org/");
+
+    CHECK(tr.events == std::vector<std::string>{
+        "B url::parse",
+        "B host_parser::parse_host",
+        "B domain_to_ascii",
+        "E domain_to_ascii",
+        "E host_parser::parse_host",
+        "E url::parse",
+        "B url_search_params::parse",
+        "E url_search_params::parse",
+    });
+}
+
+TEST_CASE("Tracing of URL setters") {
+    recording_tracer tr;
+    upa::url u("http://example.org/");
+    {
+        const tracer_guard guard(tr);
+        CHECK(u.hostname("example.net"));
+        CHECK(u.username("user"));
+        CHECK(u.href("http://h/"));
+    }
+    CHECK(tr.events == std::vector<std::string>{
+        "B url::hostname",
+        "B host_parser::parse_host",
+        "E host_parser::parse_host",
+        "E url::hostname",
+        "B url::username",
+        "E url::username",
+        "B url::href",
+        "B url::parse",
+        "B host_parser::parse_host",
+        "E host_parser::parse_host",
+        "E url::parse",
+        "E url::href",
+    });
+}
+
+TEST_CASE("chrome_trace_writer") {
+    upa::tracing::chrome_trace_writer writer;
+    {
+        const tracer_guard guard(writer);
+        upa::url u("http://example.org/");
+    }
+    CHECK(writer.size() == 4);
+
+    std::ostringstream out;
+    writer.write(out);
+    const std::string json = out.str();
+    CHECK(json.find("{\"traceEvents\":[") == 0);
+    CHECK(json.find("{\"name\":\"url::parse\",\"cat\":\"upa\",\"ph\":\"B\",\"ts\":") != std::string::npos);
+    CHECK(json.find("{\"name\":\"host_parser::parse_host\",\"cat\":\"upa\",\"ph\":\"E\",\"ts\":") != std::string::npos);
+
+    writer.clear();
+    CHECK(writer.size() == 0);
+}
+
+#else
+
+TEST_CASE("Tracing macro expands to nothing") {
+    UPA_TRACE_SCOPE("any name");
+    CHECK(upa::url::can_parse("https://example.org/"));
+}
+
+#endif
@@ -100,3 +100,22 @@ TEST_CASE("upa::util::has_xn_label") {
     CHECK_FALSE(has_xn_label(L"an--"));
     CHECK_FALSE(has_xn_label(L"abc.xz--"));
 }
+
+TEST_CASE("upa::util::hasher") {
+    const std::string str = "https://example.org/path/to/resource?query#fragment";
+
+    const auto h = upa::util::hash_bytes(str.data(), str.length());
+    CHECK(h != upa::util::hash_bytes(str.data(), str.length() - 1));
+    CHECK(upa::util::hash_bytes(nullptr, 0) == upa::util::hash_bytes("", 0));
+
+    // the result does not depend on how the input is split
+    for (std::size_t i = 0; i <= str.length(); ++i) {
+        for (std::size_t j = i; j <= str.length(); ++j) {
+            upa::util::hasher hs;
+            hs.update(str.data(), i);
+            hs.update(str.data() + i, j - i);
+            hs.update(str.data() + j, str.length() - j);
+            CHECK(hs.result() == h);
+        }
+    }
+}
@@ -0,0 +1,527 @@
+// Copyright 2024 Rimas Misevičius
+// Distributed under the BSD-style license that can be
+// found in the LICENSE file.
+//
+
+// Generates synthetic URL corpus for the bench-url benchmark.
+//
+// The output is deterministic: the same options and seed produce the same
+// corpus on every platform, because the generator does not use the
+// implementation-defined distributions of <random>.
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// -----------------------------------------------------------------------------
+// Deterministic random numbers (SplitMix64)
+
+class random_gen {
+public:
+    explicit random_gen(uint64_t seed) : state_(seed) {}
+
+    uint64_t next() {
+        uint64_t z = (state_ += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    // uniform in [0, 1)
+    double real() {
+        return static_cast<double>(next() >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    bool chance(double p) {
+        return real() < p;
+    }
+
+    // uniform in [min, max]
+    std::size_t range(std::size_t min, std::size_t max) {
+        if (max <= min)
+            return min;
+        return min + static_cast<std::size_t>(next() % (max - min + 1));
+    }
+
+    template <class T, std::size_t N>
+    const T& pick(const T (&arr)[N]) {
+        return arr[next() % N];
+    }
+
+private:
+    uint64_t state_;
+};
+
+// -----------------------------------------------------------------------------
+// Options
+
+struct size_range {
+    std::size_t min;
+    std::size_t max;
+};
+
+struct options {
+    std::size_t count = 10000;
+    uint64_t seed = 1;
+    std::string format; // "txt" or "json"; by default from the output file extension
+    std::string output;
+    // scheme mix: scheme and its weight
+    std::vector<std::pair<std::string, double>> schemes = {
+        { "https", 70 }, { "http", 20 }, { "file", 3 }, { "wss", 2 },
+        { "mailto", 2 }, { "foo", 3 }
+    };
+    double idn = 0.05;          // share of IDN hosts
+    double ipv4 = 0.03;         // share of IPv4 hosts
+    double ipv6 = 0.01;         // share of IPv6 hosts
+    size_range path_depth = { 0, 5 };
+    size_range segment_length = { 1, 12 };
+    double percent = 0.02;      // probability of a character to be percent encoded or to need encoding
+    size_range query_params = { 0, 4 };
+    double query_share = 0.4;   // share of URLs with a query
+    double fragment_share = 0.05;
+    double dot_segments = 0.02; // probability of a path segment to be "." or ".."
+    double long_share = 0.01;   // share of URLs with a long query value
+    size_range long_length = { 256, 2048 };
+    double relative = 0.0;      // share of relative URLs with a base (JSON output only)
+};
+
+bool parse_number(const char* str, uint64_t& value) {
+    char* end = nullptr;
+    value = std::strtoull(str, &end, 10);
+    return end != str && *end == 0;
+}
+
+bool parse_size(const char* str, std::size_t& value) {
+    uint64_t val;
+    if (!parse_number(str, val))
+        return false;
+    value = static_cast<std::size_t>(val);
+    return true;
+}
+
+bool parse_share(const char* str, double& value) {
+    char* end = nullptr;
+    value = std::strtod(str, &end);
+    return end != str && *end == 0 && value >= 0 && value <= 1;
+}
+
+// MIN-MAX or N
+bool parse_range(const char* str, size_range& value) {
+    const char* dash = std::strchr(str, '-');
+    if (dash == nullptr) {
+        if (!parse_size(str, value.min))
+            return false;
+        value.max = value.min;
+        return true;
+    }
+    const std::string min_str(str, dash);
+    return parse_size(min_str.c_str(), value.min) &&
+        parse_size(dash + 1, value.max) &&
+        value.min <= value.max;
+}
+
+// SCHEME:WEIGHT,SCHEME:WEIGHT,...
+bool parse_schemes(const char* str, std::vector<std::pair<std::string, double>>& value) {
+    value.clear();
+    while (*str) {
+        const char* end = std::strchr(str, ',');
+        if (end == nullptr)
+            end = str + std::strlen(str);
+        const std::string item(str, end);
+        const auto colon = item.find(':');
+        if (colon == 0 || colon == std::string::npos)
+            return false;
+        char* wend = nullptr;
+        const double weight = std::strtod(item.c_str() + colon + 1, &wend);
+        if (*wend != 0 || weight < 0)
+            return false;
+        value.emplace_back(item.substr(0, colon), weight);
+        str = *end ? end + 1 : end;
+    }
+    return !value.empty();
+}
+
+bool parse_option(options& opt, const std::string& name, const char* value) {
+    if (name == "count") return parse_size(value, opt.count);
+    if (name == "seed") return parse_number(value, opt.seed);
+    if (name == "format") {
+        opt.format = value;
+        return opt.format == "txt" || opt.format == "json";
+    }
+    if (name == "output") {
+        opt.output = value;
+        return !opt.output.empty();
+    }
+    if (name == "schemes") return parse_schemes(value, opt.schemes);
+    if (name == "idn") return parse_share(value, opt.idn);
+    if (name == "ipv4") return parse_share(value, opt.ipv4);
+    if (name == "ipv6") return parse_share(value, opt.ipv6);
+    if (name == "path-depth") return parse_range(value, opt.path_depth);
+    if (name == "segment-length") return parse_range(value, opt.segment_length) && opt.segment_length.min > 0;
+    if (name == "percent") return parse_share(value, opt.percent);
+    if (name == "query-params") return parse_range(value, opt.query_params);
+    if (name == "query") return parse_share(value, opt.query_share);
+    if (name == "fragment") return parse_share(value, opt.fragment_share);
+    if (name == "dot-segments") return parse_share(value, opt.dot_segments);
+    if (name == "long") return parse_share(value, opt.long_share);
+    if (name == "long-length") return parse_range(value, opt.long_length);
+    if (name == "relative") return parse_share(value, opt.relative);
+    return false;
+}
+
+// -----------------------------------------------------------------------------
+// URL generator
+
+class url_generator {
+public:
+    explicit url_generator(const options& opt)
+        : opt_(opt)
+        , rnd_(opt.seed)
+    {
+        for (const auto& scheme : opt_.schemes)
+            total_weight_ += scheme.second;
+    }
+
+    // Generates URL; if base is not empty, then the URL is relative to it
+    void generate(std::string& input, std::string& base) {
+        input.clear();
+        base.clear();
+
+        const std::string& scheme = pick_scheme();
+        if (scheme == "mailto") {
+            input += "mailto:";
+            append_chars(input, lower_alnum, rnd_.range(opt_.segment_length.min, opt_.segment_length.max));
+            input += '@';
+            append_domain(input);
+            append_query_fragment(input);
+            return;
+        }
+
+        const bool relative = opt_.relative > 0 && rnd_.chance(opt_.relative);
+        std::string& absolute = relative ? base : input;
+        absolute += scheme;
+        absolute += "://";
+        if (scheme != "file")
+            append_host(absolute);
+
+        if (relative) {
+            // the base path and relative input
+            append_path(base);
+            append_path(input);
+            if (!input.empty() && input[0] == '/' && rnd_.chance(0.5))
+                input.erase(0, 1); // path relative
+        } else {
+            append_path(input);
+        }
+        append_query_fragment(input);
+    }
+
+private:
+    static const char lower_alnum[];
+    static const char path_chars[];
+
+    const std::string& pick_scheme() {
+        double w = rnd_.real() * total_weight_;
+        for (const auto& scheme : opt_.schemes) {
+            if (w < scheme.second)
+                return scheme.first;
+            w -= scheme.second;
+        }
+        return opt_.schemes.back().first;
+    }
+
+    void append_chars(std::string& str, const char* chars, std::size_t count) {
+        const std::size_t len = std::strlen(chars);
+        for (std::size_t i = 0; i < count; ++i)
+            str += chars[rnd_.next() % len];
+    }
+
+    void append_label(std::string& str, bool idn) {
+        const std::size_t len = rnd_.range(2, 10);
+        if (idn) {
+            static const char* const letters[] = {
+                "\xC4\x85", "\xC4\x8D", "\xC4\x99", "\xC4\x97", "\xC5\xA1", "\xC5\xBE", // ą č ę ė š ž
+                "\xC3\xBC", "\xC3\xB6", "\xC3\xA9", // ü ö é
+                "\xD0\xB4", "\xD0\xBE", "\xD0\xBC", // д о м
+                "\xE6\x97\xA5", "\xE6\x9C\xAC" // 日 本
+            };
+            // at least one non-ASCII character
+            const std::size_t pos = rnd_.range(0, len - 1);
+            for (std::size_t i = 0; i < len; ++i) {
+                if (i == pos || rnd_.chance(0.3))
+                    str += rnd_.pick(letters);
+                else
+                    str += lower_alnum[rnd_.next() % 26];
+            }
+        } else {
+            append_chars(str, lower_alnum, len);
+        }
+    }
+
+    void append_domain(std::string& str) {
+        static const char* const tlds[] = { "com", "org", "net", "io", "lt", "de", "example" };
+        const bool idn = rnd_.chance(opt_.idn);
+        const std::size_t labels = rnd_.range(1, 3);
+        for (std::size_t i = 0; i < labels; ++i) {
+            append_label(str, idn && i == labels - 1);
+            str += '.';
+        }
+        str += rnd_.pick(tlds);
+    }
+
+    void append_ipv4(std::string& str) {
+        // mostly canonical dotted decimal, sometimes hexadecimal
+        const bool hex = rnd_.chance(0.1);
+        for (int i = 0; i < 4; ++i) {
+            if (i) str += '.';
+            const unsigned part = static_cast<unsigned>(rnd_.range(0, 255));
+            if (hex) {
+                static const char hex_digits[] = "0123456789abcdef";
+                str += "0x";
+                str += hex_digits[part >> 4];
+                str += hex_digits[part & 0xF];
+            } else {
+                str += std::to_string(part);
+            }
+        }
+    }
+
+    void append_ipv6_piece(std::string& str) {
+        static const char hex_digits[] = "0123456789abcdef";
+        unsigned piece = static_cast<unsigned>(rnd_.next() & 0xFFFF);
+        if (rnd_.chance(0.5)) piece &= 0xFF;
+        bool lead = true;
+        for (int shift = 12; shift >= 0; shift -= 4) {
+            const unsigned digit = (piece >> shift) & 0xF;
+            if (lead && digit == 0 && shift)
+                continue;
+            lead = false;
+            str += hex_digits[digit];
+        }
+    }
+
+    void append_ipv6(std::string& str) {
+        // a run of zero pieces to compress
+        const std::size_t zero_start = rnd_.range(0, 6);
+        const std::size_t zero_len = rnd_.chance(0.7) ? rnd_.range(2, 8 - zero_start) : 0;
+        const std::size_t zero_end = zero_start + zero_len;
+        str += '[';
+        for (std::size_t i = 0; i < 8; ++i) {
+            if (zero_len && i >= zero_start && i < zero_end) {
+                if (i == zero_start)
+                    str += "::";
+                continue;
+            }
+            if (i && !(zero_len && i == zero_end))
+                str += ':';
+            append_ipv6_piece(str);
+        }
+        str += ']';
+    }
+
+    void append_host(std::string& str) {
+        const double r = rnd_.real();
+        if (r < opt_.ipv4)
+            append_ipv4(str);
+        else if (r < opt_.ipv4 + opt_.ipv6)
+            append_ipv6(str);
+        else
+            append_domain(str);
+        if (rnd_.chance(0.02)) {
+            str += ':';
+            str += std::to_string(rnd_.range(1, 65535));
+        }
+    }
+
+    // Appends characters that may be percent encoded or need encoding
+    void append_text(std::string& str, const char* chars, std::size_t len) {
+        static const char* const need_encoding[] = {
+            " ", "\"", "<", ">", "`", "{", "}",
+            "\xC4\x85", "\xC5\xBE", "\xC3\xBC", "\xE2\x82\xAC", "\xF0\x9F\x98\x80" // ą ž ü € 😀
+        };
+        static const char hex_digits[] = "0123456789ABCDEF";
+        for (std::size_t i = 0; i < len; ++i) {
+            if (opt_.percent > 0 && rnd_.chance(opt_.percent)) {
+                if (rnd_.chance(0.5)) {
+                    const unsigned c = static_cast<unsigned>(rnd_.range(0x20, 0xFF));
+                    str += '%';
+                    str += hex_digits[c >> 4];
+                    str += hex_digits[c & 0xF];
+                } else {
+                    str += rnd_.pick(need_encoding);
+                }
+            } else {
+                str += chars[rnd_.next() % std::strlen(chars)];
+            }
+        }
+    }
+
+    void append_path(std::string& str) {
+        const std::size_t depth = rnd_.range(opt_.path_depth.min, opt_.path_depth.max);
+        if (depth == 0) {
+            str += '/';
+            return;
+        }
+        for (std::size_t i = 0; i < depth; ++i) {
+            str += '/';
+            if (opt_.dot_segments > 0 && rnd_.chance(opt_.dot_segments)) {
+                str += rnd_.chance(0.5) ? "." : "..";
+                continue;
+            }
+            append_text(str, path_chars, rnd_.range(opt_.segment_length.min, opt_.segment_length.max));
+        }
+        if (rnd_.chance(0.3)) {
+            static const char* const exts[] = { ".html", ".php", ".js", ".png", ".json", "/" };
+            str += rnd_.pick(exts);
+        }
+    }
+
+    void append_query_fragment(std::string& str) {
+        const bool is_long = opt_.long_share > 0 && rnd_.chance(opt_.long_share);
+        if (is_long || rnd_.chance(opt_.query_share)) {
+            str += '?';
+            const std::size_t count = rnd_.range(opt_.query_params.min, opt_.query_params.max);
+            for (std::size_t i = 0; i < count; ++i) {
+                if (i) str += '&';
+                append_text(str, lower_alnum, rnd_.range(1, 8));
+                str += '=';
+                append_text(str, path_chars, rnd_.range(0, opt_.segment_length.max));
+            }
+            if (is_long) {
+                if (count) str += '&';
+                str += "data=";
+                append_text(str, path_chars, rnd_.range(opt_.long_length.min, opt_.long_length.max));
+            }
+        }
+        if (rnd_.chance(opt_.fragment_share)) {
+            str += '#';
+            append_text(str, path_chars, rnd_.range(opt_.segment_length.min, opt_.segment_length.max));
+        }
+    }
+
+private:
+    const options& opt_;
+    random_gen rnd_;
+    double total_weight_ = 0;
+};
+
+const char url_generator::lower_alnum[] = "abcdefghijklmnopqrstuvwxyz0123456789";
+const char url_generator::path_chars[] =
+    "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789-._~";
+
+// -----------------------------------------------------------------------------
+// Output
+
+void write_json_string(std::ostream& out, const std::string& str) {
+    static const char hex_digits[] = "0123456789abcdef";
+    out << '"';
+    for (const char c : str) {
+        const auto uc = static_cast<unsigned char>(c);
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        } else if (uc < 0x20) {
+            out << "\\u00" << hex_digits[uc >> 4] << hex_digits[uc & 0xF];
+        } else {
+            out << c;
+        }
+    }
+    out << '"';
+}
+
+int generate(const options& opt, std::ostream& out) {
+    const bool json = opt.format == "json";
+    url_generator gen(opt);
+    std::string input, base;
+
+    if (json) out << "[\n";
+    for (std::size_t i = 0; i < opt.count; ++i) {
+        gen.generate(input, base);
+        if (json) {
+            out << "  {\"input\": ";
+            write_json_string(out, input);
+            out << ", \"base\": ";
+            if (base.empty())
+                out << "null";
+            else
+                write_json_string(out, base);
+            out << (i + 1 < opt.count ? "},\n" : "}\n");
+        } else {
+            out << input << '\n';
+        }
+    }
+    if (json) out << "]\n";
+    return out ? 0 : 2;
+}
+
+void usage() {
+    std::cerr <<
+        "Usage: genUrlCorpus [--option=value ...]\n"
+        "Options:\n"
+        "  --count=N               number of URLs (10000)\n"
+        "  --seed=N                random seed (1)\n"
+        "  --output=FILE           output file (stdout)\n"
+        "  --format=txt|json       output format (by the FILE extension, or txt)\n"
+        "  --schemes=S:W,...       scheme mix with weights\n"
+        "                          (https:70,http:20,file:3,wss:2,mailto:2,foo:3)\n"
+        "  --idn=P                 share of IDN hosts (0.05)\n"
+        "  --ipv4=P                share of IPv4 hosts (0.03)\n"
+        "  --ipv6=P                share of IPv6 hosts (0.01)\n"
+        "  --path-depth=MIN-MAX    path segment count (0-5)\n"
+        "  --segment-length=MIN-MAX  path segment length (1-12)\n"
+        "  --percent=P             probability of a character to be percent\n"
+        "                          encoded or to need encoding (0.02)\n"
+        "  --query=P               share of URLs with a query (0.4)\n"
+        "  --query-params=MIN-MAX  query parameter count (0-4)\n"
+        "  --fragment=P            share of URLs with a fragment (0.05)\n"
+        "  --dot-segments=P        probability of a path segment to be . or .. (0.02)\n"
+        "  --long=P                share of URLs with a long query value (0.01)\n"
+        "  --long-length=MIN-MAX   length of the long query value (256-2048)\n"
+        "  --relative=P            share of relative URLs with base, JSON only (0)\n";
+}
+
+} // namespace
+
+int main(int argc, const char* argv[])
+{
+    options opt;
+
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const char* eq = std::strchr(arg, '=');
+        if (std::strncmp(arg, "--", 2) != 0 || eq == nullptr) {
+            usage();
+            return 1;
+        }
+        const std::string name(arg + 2, eq);
+        if (!parse_option(opt, name, eq + 1)) {
+            std::cerr << "Invalid option: " << arg << '\n';
+            usage();
+            return 1;
+        }
+    }
+    if (opt.format.empty()) {
+        const auto len = opt.output.length();
+        opt.format = len > 5 && opt.output.compare(len - 5, 5, ".json") == 0 ? "json" : "txt";
+    }
+    if (opt.relative > 0 && opt.format != "json") {
+        std::cerr << "Relative URLs require JSON output\n";
+        return 1;
+    }
+
+    if (opt.output.empty())
+        return generate(opt, std::cout);
+
+    std::ofstream fout(opt.output, std::ios_base::out | std::ios_base::binary);
+    if (!fout.is_open()) {
+        std::cerr << "Failed to open " << opt.output << '\n';
+        return 2;
+    }
+    return generate(opt, fout);
+}